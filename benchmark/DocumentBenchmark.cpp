@@ -0,0 +1,149 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "RichTextCorpus.h"
+#include "RichTextDocument.h"
+
+// The document core over generated screenplays from 1 to 500 pages, each at three style
+// densities. Run with --benchmark_out=<file> --benchmark_out_format=json, or build the
+// scriptr_bench_json target, and compare two runs with benchmark's tools/compare.py.
+static void CorpusArguments(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"pages", "style%"});
+    for (int pages : {1, 10, 100, 500})
+        for (int density : {0, 25, 100})
+            benchmark->Args({pages, density});
+}
+
+static std::string MakeCorpus(const benchmark::State& state)
+{
+    return MakeScreenplayJSON(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+}
+
+static void BM_Document_ImportJSON(benchmark::State& state)
+{
+    auto json = MakeCorpus(state);
+    for (auto _ : state)
+    {
+        RichTextDocument doc;
+        doc.ImportFromJSON(json);
+        benchmark::DoNotOptimize(doc.GetLineCount());
+    }
+    state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+static void BM_Document_GetLineCount(benchmark::State& state)
+{
+    RichTextDocument doc;
+    doc.ImportFromJSON(MakeCorpus(state));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(doc.GetLineCount());
+}
+
+// Looks up a random line and walks its runs, what drawing or measuring a paragraph costs
+// before any layout.
+static void BM_Document_GetLine(benchmark::State& state)
+{
+    RichTextDocument doc;
+    doc.ImportFromJSON(MakeCorpus(state));
+
+    CorpusRandom random(2);
+    auto lines = doc.GetLineCount();
+    for (auto _ : state)
+    {
+        std::size_t length = 0;
+        for (const auto& run : doc.GetLine(random.Below(lines)))
+            length += run.text.size();
+        benchmark::DoNotOptimize(length);
+    }
+}
+
+static void BM_Document_Insert(benchmark::State& state)
+{
+    RichTextDocument doc;
+    doc.ImportFromJSON(MakeCorpus(state));
+
+    CorpusRandom random(3);
+    for (auto _ : state)
+        doc.Insert(random.Below(doc.GetDocumentCharacterLength() + 1), "x");
+}
+
+static void BM_Document_Remove(benchmark::State& state)
+{
+    auto json = MakeCorpus(state);
+    RichTextDocument doc;
+    doc.ImportFromJSON(json);
+    const auto length = doc.GetDocumentCharacterLength();
+
+    CorpusRandom random(4);
+    for (auto _ : state)
+    {
+        // Refill before small documents run out, rarely enough not to show in the timing.
+        if (doc.GetDocumentCharacterLength() < length / 2)
+        {
+            state.PauseTiming();
+            doc.ImportFromJSON(json);
+            state.ResumeTiming();
+        }
+
+        auto start = random.Below(doc.GetDocumentCharacterLength());
+        doc.Remove(start, start + 1);
+    }
+}
+
+// Exports into a sink that only counts bytes, this is the cost of producing the output
+// without whatever the destination itself costs.
+static void BM_Document_ExportJSON(benchmark::State& state)
+{
+    RichTextDocument doc;
+    doc.ImportFromJSON(MakeCorpus(state));
+
+    std::size_t bytes = 0;
+    for (auto _ : state)
+        doc.ExportToJSON([&bytes](std::string_view chunk) { bytes += chunk.size(); });
+    state.SetBytesProcessed(bytes);
+}
+
+static void BM_Document_ExportHTML(benchmark::State& state)
+{
+    RichTextDocument doc;
+    doc.ImportFromJSON(MakeCorpus(state));
+
+    std::size_t bytes = 0;
+    for (auto _ : state)
+        doc.ExportToHTML([&bytes](std::string_view chunk) { bytes += chunk.size(); });
+    state.SetBytesProcessed(bytes);
+}
+
+// The old way of exporting, building the whole JSON tree before dumping it, for comparison.
+static void BM_Document_ExportJSON_DOM(benchmark::State& state)
+{
+    RichTextDocument doc;
+    doc.ImportFromJSON(MakeCorpus(state));
+
+    std::size_t bytes = 0;
+    for (auto _ : state)
+    {
+        auto children = nlohmann::json::array();
+        for (const auto& block : doc.GetBlocks())
+        {
+            nlohmann::json object{{"text", block.text}};
+            if (block.propertyFlags & RichTextPropertyFlags_Bold) object["bold"] = true;
+            if (block.propertyFlags & RichTextPropertyFlags_Italic) object["italic"] = true;
+            if (block.propertyFlags & RichTextPropertyFlags_Underline) object["underline"] = true;
+            children.push_back(std::move(object));
+        }
+        bytes += nlohmann::json{{"children", std::move(children)}}.dump().size();
+    }
+    state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK(BM_Document_ImportJSON)->Apply(CorpusArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Document_GetLineCount)->Apply(CorpusArguments);
+BENCHMARK(BM_Document_GetLine)->Apply(CorpusArguments);
+BENCHMARK(BM_Document_Insert)->Apply(CorpusArguments);
+BENCHMARK(BM_Document_Remove)->Apply(CorpusArguments);
+BENCHMARK(BM_Document_ExportJSON)->Apply(CorpusArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Document_ExportHTML)->Apply(CorpusArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Document_ExportJSON_DOM)->Apply(CorpusArguments)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,60 @@
+#include <cstdio>
+
+#include <benchmark/benchmark.h>
+
+#include "imgui.h"
+
+#include "FontAtlasCache.h"
+#include "FontGlyphCache.h"
+#include "ScriptFonts.h"
+
+static const char* kAtlasCachePath = "scriptr_bench_fontatlas.cache";
+
+// Startup without a cache file, every glyph goes through FreeType.
+static void BM_FontAtlas_Cold(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        ImFontAtlas atlas;
+        FontGlyphCache glyphCache(&atlas);
+        AddScriptFonts(atlas, glyphCache);
+        atlas.Build();
+        glyphCache.ShareFallbackGlyphs();
+        benchmark::DoNotOptimize(atlas.TexWidth);
+    }
+}
+
+// Startup with the atlas restored from the file written by a previous launch.
+static void BM_FontAtlas_Warm(benchmark::State& state)
+{
+    {
+        ImFontAtlas atlas;
+        FontGlyphCache glyphCache(&atlas);
+        AddScriptFonts(atlas, glyphCache);
+        atlas.Build();
+        if (!FontAtlasCache::Save(&atlas, kAtlasCachePath, &glyphCache))
+        {
+            state.SkipWithError("Could not write the font atlas cache");
+            return;
+        }
+    }
+
+    for (auto _ : state)
+    {
+        ImFontAtlas atlas;
+        FontGlyphCache glyphCache(&atlas);
+        AddScriptFonts(atlas, glyphCache);
+        if (!FontAtlasCache::Load(&atlas, kAtlasCachePath, &glyphCache))
+        {
+            state.SkipWithError("Font atlas cache missed");
+            break;
+        }
+        glyphCache.ShareFallbackGlyphs();
+        benchmark::DoNotOptimize(atlas.TexWidth);
+    }
+
+    std::remove(kAtlasCachePath);
+}
+
+BENCHMARK(BM_FontAtlas_Cold)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FontAtlas_Warm)->Unit(benchmark::kMillisecond);
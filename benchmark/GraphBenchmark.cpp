@@ -0,0 +1,237 @@
+#include <numeric>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "RichTextCorpus.h"
+#include "graph.h"
+
+// The sorted IdMap the node graph used to be stored in against the SlotMap it is stored in
+// now, at story graph sizes. Ids are handed out in increasing order like Graph does, erases
+// and lookups hit random ids.
+struct GraphBenchmarkNode {
+    int value;
+    float x, y;
+};
+
+static std::vector<int> ShuffledIndices(std::size_t count, uint64_t seed)
+{
+    std::vector<int> indices(count);
+    std::iota(indices.begin(), indices.end(), 0);
+
+    CorpusRandom random(seed);
+    for (std::size_t i = count; i > 1; i--)
+        std::swap(indices[i - 1], indices[random.Below(i)]);
+    return indices;
+}
+
+static void BM_IdMap_Insert(benchmark::State& state)
+{
+    auto count = static_cast<int>(state.range(0));
+    for (auto _ : state)
+    {
+        example::IdMap<GraphBenchmarkNode> map;
+        for (int id = 0; id < count; id++)
+            map.insert(id, GraphBenchmarkNode{id, 0.0f, 0.0f});
+        benchmark::DoNotOptimize(map.size());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void BM_SlotMap_Insert(benchmark::State& state)
+{
+    auto count = static_cast<int>(state.range(0));
+    for (auto _ : state)
+    {
+        example::SlotMap<GraphBenchmarkNode> map;
+        for (int id = 0; id < count; id++)
+            map.insert(GraphBenchmarkNode{id, 0.0f, 0.0f});
+        benchmark::DoNotOptimize(map.size());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void BM_IdMap_Find(benchmark::State& state)
+{
+    auto count = static_cast<std::size_t>(state.range(0));
+    example::IdMap<GraphBenchmarkNode> map;
+    for (int id = 0; id < static_cast<int>(count); id++)
+        map.insert(id, GraphBenchmarkNode{id, 0.0f, 0.0f});
+    auto order = ShuffledIndices(count, 1);
+
+    for (auto _ : state)
+    {
+        int sum = 0;
+        for (int id : order)
+            sum += map.find(id)->value;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void BM_SlotMap_Find(benchmark::State& state)
+{
+    auto count = static_cast<std::size_t>(state.range(0));
+    example::SlotMap<GraphBenchmarkNode> map;
+    std::vector<int> ids;
+    for (int i = 0; i < static_cast<int>(count); i++)
+        ids.push_back(map.insert(GraphBenchmarkNode{i, 0.0f, 0.0f}));
+    auto order = ShuffledIndices(count, 1);
+
+    for (auto _ : state)
+    {
+        int sum = 0;
+        for (int index : order)
+            sum += map.find(ids[index])->value;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Fills the map and erases everything again in random order, the fill is not timed.
+static void BM_IdMap_Erase(benchmark::State& state)
+{
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto order = ShuffledIndices(count, 2);
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        example::IdMap<GraphBenchmarkNode> map;
+        for (int id = 0; id < static_cast<int>(count); id++)
+            map.insert(id, GraphBenchmarkNode{id, 0.0f, 0.0f});
+        state.ResumeTiming();
+
+        for (int id : order)
+            map.erase(id);
+        benchmark::DoNotOptimize(map.size());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void BM_SlotMap_Erase(benchmark::State& state)
+{
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto order = ShuffledIndices(count, 2);
+    std::vector<int> ids(count);
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        example::SlotMap<GraphBenchmarkNode> map;
+        for (int i = 0; i < static_cast<int>(count); i++)
+            ids[i] = map.insert(GraphBenchmarkNode{i, 0.0f, 0.0f});
+        state.ResumeTiming();
+
+        for (int index : order)
+            map.erase(ids[index]);
+        benchmark::DoNotOptimize(map.size());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void BM_IdMap_Iterate(benchmark::State& state)
+{
+    auto count = static_cast<int>(state.range(0));
+    example::IdMap<GraphBenchmarkNode> map;
+    for (int id = 0; id < count; id++)
+        map.insert(id, GraphBenchmarkNode{id, 0.0f, 0.0f});
+
+    for (auto _ : state)
+    {
+        int sum = 0;
+        for (const auto& node : map.elements())
+            sum += node.value;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void BM_SlotMap_Iterate(benchmark::State& state)
+{
+    auto count = static_cast<int>(state.range(0));
+    example::SlotMap<GraphBenchmarkNode> map;
+    for (int i = 0; i < count; i++)
+        map.insert(GraphBenchmarkNode{i, 0.0f, 0.0f});
+
+    for (auto _ : state)
+    {
+        int sum = 0;
+        for (const auto& node : map.elements())
+            sum += node.value;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+// A story graph: nodes, then three links out of each.
+static example::Graph<GraphBenchmarkNode> MakeStoryGraph(std::size_t count, std::vector<int>& nodes)
+{
+    example::Graph<GraphBenchmarkNode> graph;
+    nodes.clear();
+    for (std::size_t i = 0; i < count; i++)
+        nodes.push_back(graph.insert_node(GraphBenchmarkNode{static_cast<int>(i), 0.0f, 0.0f}));
+
+    CorpusRandom random(3);
+    for (std::size_t i = 0; i < count; i++)
+        for (int link = 0; link < 3; link++)
+            graph.insert_edge(nodes[i], nodes[random.Below(count)]);
+    return graph;
+}
+
+static void BM_Graph_Build(benchmark::State& state)
+{
+    auto count = static_cast<std::size_t>(state.range(0));
+    std::vector<int> nodes;
+    for (auto _ : state)
+    {
+        auto graph = MakeStoryGraph(count, nodes);
+        benchmark::DoNotOptimize(graph.edges().begin());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+// Deleting a selection of a tenth of the nodes, one at a time and as a batch.
+static void BM_Graph_EraseSelection(benchmark::State& state)
+{
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto batch = state.range(1) != 0;
+    auto order = ShuffledIndices(count, 4);
+    std::vector<int> nodes;
+    std::vector<int> selection;
+    example::Graph<GraphBenchmarkNode> graph;
+
+    for (auto _ : state)
+    {
+        // The previous graph is freed here too, outside the timing.
+        state.PauseTiming();
+        graph = MakeStoryGraph(count, nodes);
+        selection.clear();
+        for (std::size_t i = 0; i < count / 10; i++)
+            selection.push_back(nodes[order[i]]);
+        state.ResumeTiming();
+
+        if (batch)
+        {
+            graph.erase_nodes(selection);
+        }
+        else
+        {
+            for (int node : selection)
+                graph.erase_node(node);
+        }
+        benchmark::DoNotOptimize(graph.edges().begin());
+    }
+    state.SetItemsProcessed(state.iterations() * (count / 10));
+}
+
+BENCHMARK(BM_IdMap_Insert)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SlotMap_Insert)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_IdMap_Find)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SlotMap_Find)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_IdMap_Erase)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SlotMap_Erase)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_IdMap_Iterate)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SlotMap_Iterate)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Graph_Build)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Graph_EraseSelection)->ArgNames({"nodes", "batch"})->ArgsProduct({{10000, 100000}, {0, 1}})->Unit(benchmark::kMicrosecond);
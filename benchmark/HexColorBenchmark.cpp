@@ -0,0 +1,85 @@
+#include <optional>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include "RichTextColor.h"
+#include "RichTextDocument.h"
+
+// The property strings a loader sees on a property heavy document: mostly colors in every
+// form, mixed with links and other strings that have to be rejected.
+static std::vector<std::string> MakePropertyStrings()
+{
+    std::vector<std::string> strings;
+    for (int i = 0; i < 1024; i++)
+    {
+        switch (i % 6)
+        {
+        case 0: strings.push_back("#336699"); break;
+        case 1: strings.push_back("#f80"); break;
+        case 2: strings.push_back("#33669980"); break;
+        case 3: strings.push_back("#f80c"); break;
+        case 4: strings.push_back("https://example.com/scene/" + std::to_string(i)); break;
+        case 5: strings.push_back("#notacolor"); break;
+        }
+    }
+    return strings;
+}
+
+// The previous std::regex based implementation, kept here as the baseline.
+static std::optional<uint32_t> ParseHexColorRegex(const std::string& code)
+{
+    static std::regex hexColorTest("^#(?:[0-9a-fA-F]{3,4}){1,2}$", std::regex_constants::optimize);
+    if (std::regex_search(code, hexColorTest))
+        return static_cast<uint32_t>(std::stoul(code.substr(1).data(), nullptr, 16));
+    else return std::nullopt;
+}
+
+static void BM_ParseHexColor_Regex(benchmark::State& state)
+{
+    auto strings = MakePropertyStrings();
+    for (auto _ : state)
+        for (const auto& string : strings)
+            benchmark::DoNotOptimize(ParseHexColorRegex(string));
+    state.SetItemsProcessed(state.iterations() * strings.size());
+}
+
+static void BM_ParseHexColor_Table(benchmark::State& state)
+{
+    auto strings = MakePropertyStrings();
+    for (auto _ : state)
+        for (const auto& string : strings)
+            benchmark::DoNotOptimize(RichTextColor::ParseHex(string));
+    state.SetItemsProcessed(state.iterations() * strings.size());
+}
+
+static void BM_ImportJSON_PropertyHeavy(benchmark::State& state)
+{
+    auto children = nlohmann::json::array();
+    for (int i = 0; i < state.range(0); i++)
+    {
+        children.push_back({
+            {"text", "Word "},
+            {"color", i % 2 ? "#336699" : "#f80"},
+            {"highlight", "#ffffff80"},
+            {"link", "https://example.com/" + std::to_string(i)},
+            {"note", "#abc"},
+        });
+    }
+    auto json = nlohmann::json{{"text", ""}, {"children", children}}.dump();
+
+    for (auto _ : state)
+    {
+        RichTextDocument doc;
+        doc.ImportFromJSON(json);
+        benchmark::DoNotOptimize(doc.GetDocumentCharacterLength());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 4); // String properties per block.
+}
+
+BENCHMARK(BM_ParseHexColor_Regex);
+BENCHMARK(BM_ParseHexColor_Table);
+BENCHMARK(BM_ImportJSON_PropertyHeavy)->Arg(10000)->Unit(benchmark::kMillisecond);
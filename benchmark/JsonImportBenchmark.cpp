@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include "AllocationCounter.h"
+#include "RichTextCorpus.h"
+#include "RichTextDocument.h"
+
+// Runs one import and returns the most bytes it held at once through operator new.
+template <typename Import>
+static std::size_t MeasurePeakBytes(Import&& import)
+{
+    auto liveBefore = AllocationCounter::GetLiveBytes();
+    AllocationCounter::ResetPeakBytes();
+    import();
+    return AllocationCounter::GetPeakBytes() - liveBefore;
+}
+
+static void SetImportCounters(benchmark::State& state, std::size_t jsonSize, std::size_t peakBytes)
+{
+    state.SetBytesProcessed(state.iterations() * jsonSize);
+    if (AllocationCounter::IsEnabled())
+        state.counters["peak_bytes"] = benchmark::Counter(static_cast<double>(peakBytes), benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+}
+
+// Parses into a JSON DOM and walks it. The walk is the current one, which takes objects by
+// reference, so this is a stricter baseline than the by-value walk the SAX import replaced.
+static void BM_ImportJSON_DOM(benchmark::State& state)
+{
+    auto json = MakeRichTextJSON(static_cast<int>(state.range(0)));
+
+    std::size_t peakBytes = 0;
+    for (auto _ : state)
+    {
+        peakBytes = std::max(peakBytes, MeasurePeakBytes([&]{
+            RichTextDocument doc{nlohmann::json::parse(json)};
+            benchmark::DoNotOptimize(doc.GetLineCount());
+        }));
+    }
+    SetImportCounters(state, json.size(), peakBytes);
+}
+
+static void BM_ImportJSON_SAX(benchmark::State& state)
+{
+    auto json = MakeRichTextJSON(static_cast<int>(state.range(0)));
+
+    std::size_t peakBytes = 0;
+    for (auto _ : state)
+    {
+        peakBytes = std::max(peakBytes, MeasurePeakBytes([&]{
+            RichTextDocument doc;
+            doc.ImportFromJSON(json);
+            benchmark::DoNotOptimize(doc.GetLineCount());
+        }));
+    }
+    SetImportCounters(state, json.size(), peakBytes);
+}
+
+BENCHMARK(BM_ImportJSON_DOM)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ImportJSON_SAX)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMillisecond);
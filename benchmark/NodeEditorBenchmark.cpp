@@ -0,0 +1,151 @@
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "imgui.h"
+#include "imnodes.h"
+
+#include "RichTextCorpus.h"
+
+// Drives an ImNodes editor of the given number of nodes without a backend, each node with an
+// input and an output pin and a link from every output to a random input. It has its own
+// ImGui context and puts the previous one back after every frame, so it leaves RenderHarness
+// alone.
+class NodeEditorHarness {
+public:
+    explicit NodeEditorHarness(int nodes)
+        : mNodes(nodes)
+    {
+        auto* previous = ImGui::GetCurrentContext();
+        mContext = ImGui::CreateContext();
+        ImGui::SetCurrentContext(mContext);
+        mNodesContext = ImNodes::CreateContext();
+
+        ImGuiIO& io = ImGui::GetIO();
+        io.IniFilename = nullptr;
+        io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+        io.DisplaySize = ImVec2(1600.0f, 900.0f);
+        unsigned char* pixels;
+        int width, height;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+        // A grid of nodes packed into the canvas, slightly jittered so some overlap. The top left
+        // corner is left empty for the box selector to start in.
+        CorpusRandom random(9);
+        int columns = 1;
+        while (columns * columns < nodes)
+            columns++;
+        float spacing = 1500.0f / static_cast<float>(columns);
+        for (int i = 0; i < nodes; i++)
+        {
+            mPositions.push_back(ImVec2(
+                60.0f + (i % columns) * spacing + random.Below(40),
+                60.0f + (i / columns) * spacing * 0.5f + random.Below(40)));
+            mLinks.emplace_back(i * 2 + 1, static_cast<int>(random.Below(nodes)) * 2);
+        }
+
+        Frame(ImVec2(0.0f, 0.0f), false);
+        ImGui::SetCurrentContext(previous);
+    }
+
+    ~NodeEditorHarness()
+    {
+        auto* previous = ImGui::GetCurrentContext();
+        ImGui::SetCurrentContext(mContext);
+        ImNodes::DestroyContext(mNodesContext);
+        ImGui::DestroyContext(mContext);
+        if (previous != mContext)
+            ImGui::SetCurrentContext(previous);
+    }
+
+    NodeEditorHarness(const NodeEditorHarness&) = delete;
+    NodeEditorHarness& operator=(const NodeEditorHarness&) = delete;
+
+    void Frame(ImVec2 mouse, bool mouseDown)
+    {
+        auto* previous = ImGui::GetCurrentContext();
+        ImGui::SetCurrentContext(mContext);
+        ImNodes::SetCurrentContext(mNodesContext);
+
+        ImGuiIO& io = ImGui::GetIO();
+        io.DeltaTime = 1.0f / 60.0f;
+        io.AddMousePosEvent(mouse.x, mouse.y);
+        io.AddMouseButtonEvent(0, mouseDown);
+
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+        ImGui::SetNextWindowSize(io.DisplaySize);
+        ImGui::Begin("Node Editor", nullptr, ImGuiWindowFlags_NoDecoration);
+        ImNodes::BeginNodeEditor();
+        for (int i = 0; i < mNodes; i++)
+        {
+            if (mFirstFrame)
+                ImNodes::SetNodeGridSpacePos(i, mPositions[i]);
+            ImNodes::BeginNode(i);
+            ImNodes::BeginInputAttribute(i * 2);
+            ImGui::TextUnformatted("in");
+            ImNodes::EndInputAttribute();
+            ImNodes::BeginOutputAttribute(i * 2 + 1);
+            ImGui::TextUnformatted("out");
+            ImNodes::EndOutputAttribute();
+            ImNodes::EndNode();
+        }
+        for (std::size_t i = 0; i < mLinks.size(); i++)
+            ImNodes::Link(static_cast<int>(i), mLinks[i].first, mLinks[i].second);
+        ImNodes::EndNodeEditor();
+
+        int hovered;
+        mHovered += ImNodes::IsNodeHovered(&hovered) || ImNodes::IsLinkHovered(&hovered) || ImNodes::IsPinHovered(&hovered);
+        mSelected = ImNodes::NumSelectedNodes();
+        ImGui::End();
+        ImGui::Render();
+
+        mFirstFrame = false;
+        ImGui::SetCurrentContext(previous);
+    }
+
+    int64_t GetHoveredFrames() const { return mHovered; }
+    int GetSelectedNodes() const { return mSelected; }
+
+private:
+    int mNodes;
+    ImGuiContext* mContext;
+    ImNodesContext* mNodesContext;
+    std::vector<ImVec2> mPositions;
+    std::vector<std::pair<int, int>> mLinks;
+    bool mFirstFrame = true;
+    int64_t mHovered = 0;
+    int mSelected = 0;
+};
+
+// The mouse moving over the canvas, every frame resolves the hovered pin, node or link.
+static void BM_NodeEditor_Hover(benchmark::State& state)
+{
+    NodeEditorHarness harness(static_cast<int>(state.range(0)));
+    CorpusRandom random(10);
+    for (auto _ : state)
+        harness.Frame(ImVec2(20.0f + random.Below(1560), 20.0f + random.Below(860)), false);
+    state.counters["hovered"] = benchmark::Counter(static_cast<double>(harness.GetHoveredFrames()), benchmark::Counter::kAvgIterations);
+}
+
+// Dragging a box selector from the corner, its far corner going back and forth so every
+// frame selects about the same number of nodes.
+static void BM_NodeEditor_BoxSelect(benchmark::State& state)
+{
+    NodeEditorHarness harness(static_cast<int>(state.range(0)));
+    harness.Frame(ImVec2(20.0f, 20.0f), false);
+    harness.Frame(ImVec2(20.0f, 20.0f), true);
+
+    bool far = false;
+    for (auto _ : state)
+    {
+        harness.Frame(far ? ImVec2(600.0f, 400.0f) : ImVec2(500.0f, 300.0f), true);
+        far = !far;
+    }
+    state.counters["selected"] = harness.GetSelectedNodes();
+}
+
+BENCHMARK(BM_NodeEditor_Hover)->Arg(1000)->Arg(5000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_NodeEditor_BoxSelect)->Arg(1000)->Arg(5000)->Unit(benchmark::kMillisecond);
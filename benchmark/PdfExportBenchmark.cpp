@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include "RichTextCorpus.h"
+#include "RichTextDocument.h"
+#include "ScriptPdfExporter.h"
+#include "ScriptProject.h"
+
+// The most memory the process has held so far, in MiB.
+static double GetPeakResidentMiB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+static const char* kExportPath = "scriptr_bench_export.pdf";
+static const char* kBatchPathBase = "scriptr_bench_draft";
+
+// One script of the given length, on one thread or on one per processor when the second
+// argument is zero. Items are pages.
+static void BM_PdfExport(benchmark::State& state)
+{
+    RichTextDocument doc;
+    doc.Insert(0, MakeScreenplayText(static_cast<int>(state.range(0))));
+    ScriptPdfExporter exporter(static_cast<int>(state.range(1)));
+
+    std::size_t pages = 0;
+    for (auto _ : state)
+    {
+        if (!exporter.Export(doc, kExportPath))
+        {
+            state.SkipWithError("Could not write the PDF");
+            break;
+        }
+        pages += exporter.GetLastPageCount();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(pages));
+    state.counters["layout_peak_KiB"] = exporter.GetPeakLayoutBytes() / 1024.0;
+    state.counters["process_peak_MiB"] = GetPeakResidentMiB();
+    std::remove(kExportPath);
+}
+
+// A nightly run in miniature: a project of twenty drafts, 120 pages each, exported back to back.
+static void BM_PdfExport_Batch(benchmark::State& state)
+{
+    auto scripts = nlohmann::json::array();
+    for (int i = 0; i < 20; i++)
+        scripts.push_back({{"name", "Draft " + std::to_string(i + 1)}, {"text", {{"text", MakeScreenplayText(120)}}}});
+
+    ScriptProject project;
+    if (!project.Load(nlohmann::json{{"type", "doc"}, {"scripts", scripts}}.dump()))
+    {
+        state.SkipWithError("Could not load the project");
+        return;
+    }
+
+    ScriptPdfExporter exporter(static_cast<int>(state.range(0)));
+    std::size_t pages = 0;
+    for (auto _ : state)
+    {
+        if (exporter.ExportBatch(project, kBatchPathBase) != project.GetScripts().size())
+        {
+            state.SkipWithError("Could not write every PDF");
+            break;
+        }
+        pages += exporter.GetLastPageCount();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(pages));
+    state.counters["layout_peak_KiB"] = exporter.GetPeakLayoutBytes() / 1024.0;
+    state.counters["process_peak_MiB"] = GetPeakResidentMiB();
+    for (std::size_t i = 0; i < project.GetScripts().size(); i++)
+        std::remove((ScriptProject::GetScriptPathBase(kBatchPathBase, i) + ".pdf").c_str());
+}
+
+BENCHMARK(BM_PdfExport)->Args({30, 1})->Args({30, 0})->Args({300, 1})->Args({300, 0})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_PdfExport_Batch)->Arg(1)->Arg(0)->Unit(benchmark::kMillisecond)->UseRealTime();
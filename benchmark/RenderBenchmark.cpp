@@ -0,0 +1,198 @@
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "imgui.h"
+#include "imgui_internal.h"
+
+#include "AllocationCounter.h"
+#include "FontGlyphCache.h"
+#include "RichTextCorpus.h"
+#include "RichTextDocument.h"
+#include "RichTextEditor.h"
+#include "ScriptFonts.h"
+#include "script.hpp"
+
+// Drives RichTextEditor::Render the way main does, inside a "Script" window, but without a
+// platform or renderer backend: frames end at ImGui::Render and the draw data is only
+// counted, so this runs on machines without a display or a GPU. The context and the fonts
+// are created once for all the benchmarks.
+class RenderHarness {
+public:
+    static RenderHarness& Get()
+    {
+        static RenderHarness harness;
+        return harness;
+    }
+
+    RenderHarness(const RenderHarness&) = delete;
+    RenderHarness& operator=(const RenderHarness&) = delete;
+
+    void SetDocument(RichTextDocument& doc)
+    {
+        mEditor.SetDocument(doc);
+        mPaginator = ScriptPaginator(&doc);
+        mEditor.SetPaginator(&mPaginator);
+    }
+
+    // Renders one frame, scrollFraction from 0 (top) to 1 (end) of the document when given.
+    void Frame(float width, float scrollFraction = -1.0f)
+    {
+        if (mGlyphCache.Update())
+            mContext->IO.Fonts->GetTexDataAsRGBA32(&mPixels, &mTextureWidth, &mTextureHeight);
+
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2(width, 900.0f);
+        io.DeltaTime = 1.0f / 60.0f;
+
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+        ImGui::SetNextWindowSize(io.DisplaySize);
+        ImGui::Begin("Script", nullptr, ImGuiWindowFlags_NoDecoration);
+        if (scrollFraction >= 0.0f)
+            ImGui::SetNextWindowScroll(ImVec2(0.0f, scrollFraction * mScrollMax));
+        mEditor.Render();
+        ImGui::End();
+        ImGui::Render();
+
+        // The editor's child window is the last one submitted inside "Script".
+        if (auto* window = ImGui::FindWindowByName("Script"); window && !window->DC.ChildWindows.empty())
+            mScrollMax = window->DC.ChildWindows.back()->ScrollMax.y;
+    }
+
+    int GetVertexCount() const { return ImGui::GetDrawData()->TotalVtxCount; }
+    float GetScrollMax() const { return mScrollMax; }
+
+private:
+    RenderHarness()
+        : mContext(CreateCountedContext()), mGlyphCache(mContext->IO.Fonts)
+    {
+        ImGuiIO& io = ImGui::GetIO();
+        io.IniFilename = nullptr;
+
+        auto fonts = AddScriptFonts(*io.Fonts, mGlyphCache);
+        io.Fonts->GetTexDataAsRGBA32(&mPixels, &mTextureWidth, &mTextureHeight);
+        mGlyphCache.ShareFallbackGlyphs();
+        mEditor.SetFonts(fonts.regular, fonts.bold, fonts.italic, fonts.boldItalic);
+        mEditor.SetGlyphCache(&mGlyphCache);
+    }
+
+    ~RenderHarness()
+    {
+        ImGui::DestroyContext(mContext);
+    }
+
+    // ImGui's own allocations while building the draw lists count towards allocs/frame too.
+    static ImGuiContext* CreateCountedContext()
+    {
+        AllocationCounter::CountImGuiAllocations();
+        return ImGui::CreateContext();
+    }
+
+    ImGuiContext* mContext;
+    FontGlyphCache mGlyphCache;
+    RichTextEditor mEditor;
+    ScriptPaginator mPaginator;
+    float mScrollMax = 0.0f;
+    unsigned char* mPixels = nullptr;
+    int mTextureWidth = 0;
+    int mTextureHeight = 0;
+};
+
+static void SetFrameCounters(benchmark::State& state, std::size_t vertices, std::size_t allocations)
+{
+    state.counters["vertices/frame"] = benchmark::Counter(static_cast<double>(vertices), benchmark::Counter::kAvgIterations);
+    if (AllocationCounter::IsEnabled())
+        state.counters["allocs/frame"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+// A steady frame: layout is cached and only the visible paragraphs are drawn.
+static void BM_Render_Steady(benchmark::State& state)
+{
+    RichTextDocument doc;
+    doc.ImportFromJSON(MakeScreenplayJSON(static_cast<int>(state.range(0)), 25));
+
+    auto& harness = RenderHarness::Get();
+    harness.SetDocument(doc);
+    auto width = static_cast<float>(state.range(1));
+    auto scroll = static_cast<float>(state.range(2)) / 100.0f;
+
+    // Lay everything out and find out how far the document scrolls before measuring.
+    harness.Frame(width);
+    harness.Frame(width, scroll);
+
+    std::size_t vertices = 0;
+    std::size_t allocations = 0;
+    for (auto _ : state)
+    {
+        auto allocationsBefore = AllocationCounter::GetAllocationCount();
+        harness.Frame(width, scroll);
+        allocations += AllocationCounter::GetAllocationCount() - allocationsBefore;
+        vertices += harness.GetVertexCount();
+    }
+    SetFrameCounters(state, vertices, allocations);
+}
+
+// Every frame changes the wrap width, so every paragraph is laid out again.
+static void BM_Render_Relayout(benchmark::State& state)
+{
+    RichTextDocument doc;
+    doc.ImportFromJSON(MakeScreenplayJSON(static_cast<int>(state.range(0)), 25));
+
+    auto& harness = RenderHarness::Get();
+    harness.SetDocument(doc);
+    auto width = static_cast<float>(state.range(1));
+    harness.Frame(width);
+
+    std::size_t vertices = 0;
+    std::size_t allocations = 0;
+    std::size_t frame = 0;
+    for (auto _ : state)
+    {
+        auto allocationsBefore = AllocationCounter::GetAllocationCount();
+        harness.Frame(width + static_cast<float>(frame++ % 2));
+        allocations += AllocationCounter::GetAllocationCount() - allocationsBefore;
+        vertices += harness.GetVertexCount();
+    }
+    SetFrameCounters(state, vertices, allocations);
+}
+
+// Typing into the middle of the visible page: one paragraph is laid out again and
+// pagination resumes from the edit.
+static void BM_Render_Typing(benchmark::State& state)
+{
+    RichTextDocument doc;
+    doc.ImportFromJSON(MakeScreenplayJSON(static_cast<int>(state.range(0)), 25));
+
+    auto& harness = RenderHarness::Get();
+    harness.SetDocument(doc);
+    auto width = static_cast<float>(state.range(1));
+    harness.Frame(width);
+    harness.Frame(width, 0.5f);
+
+    auto location = doc.GetLineStart(doc.GetLineCount() / 2);
+    std::size_t vertices = 0;
+    std::size_t allocations = 0;
+    for (auto _ : state)
+    {
+        auto allocationsBefore = AllocationCounter::GetAllocationCount();
+        doc.Insert(location++, "x");
+        harness.Frame(width, 0.5f);
+        allocations += AllocationCounter::GetAllocationCount() - allocationsBefore;
+        vertices += harness.GetVertexCount();
+    }
+    SetFrameCounters(state, vertices, allocations);
+}
+
+BENCHMARK(BM_Render_Steady)
+    ->ArgNames({"pages", "width", "scroll%"})
+    ->ArgsProduct({{10, 100}, {600, 1200}, {0, 50, 100}})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Render_Relayout)
+    ->ArgNames({"pages", "width"})
+    ->ArgsProduct({{10, 100}, {600, 1200}})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Render_Typing)
+    ->ArgNames({"pages", "width"})
+    ->ArgsProduct({{10, 100}, {600, 1200}})
+    ->Unit(benchmark::kMicrosecond);
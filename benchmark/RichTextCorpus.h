@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+// Builds a nested rich text document of roughly the given number of blocks, alternating the
+// kinds of properties a script carries so both parsers see a realistic mix.
+inline std::string MakeRichTextJSON(int blocks)
+{
+    auto root = nlohmann::json::object();
+    root["text"] = "INT. HOUSE - NIGHT\n";
+    root["bold"] = true;
+
+    auto children = nlohmann::json::array();
+    for (int i = 0; i < blocks; i++)
+    {
+        nlohmann::json block;
+        block["text"] = "Line " + std::to_string(i) + " of dialogue that runs long enough to wrap once or twice.\n";
+        if (i % 3 == 0) block["italic"] = true;
+        if (i % 5 == 0) block["color"] = "#336699";
+        if (i % 7 == 0) block["link"] = "https://example.com/" + std::to_string(i);
+        if (i % 11 == 0) block["children"] = nlohmann::json{{"text", "(beat) "}, {"underline", true}};
+        children.push_back(std::move(block));
+    }
+
+    root["children"] = std::move(children);
+    return root.dump();
+}
+
+// Builds a plain screenplay of roughly the given number of pages, about 55 lines each, with
+// headings, action, character cues, parentheticals and dialogue separated by blank lines.
+inline std::string MakeScreenplayText(int pages)
+{
+    static const char* const kCharacters[] = {"MARGARET", "DETECTIVE RUIZ", "THE STRANGER (V.O.)", "OWEN"};
+
+    std::string text;
+    int lines = 0;
+    for (int scene = 0; lines < pages * 55; scene++)
+    {
+        text += (scene % 2 ? "EXT. HARBOR - DAY " : "INT. HOUSE - NIGHT ") + std::to_string(scene) + "\n\n";
+        text += "Rain hammers the windows. Somewhere below, a door slams and footsteps climb the stairs.\n\n";
+        lines += 4;
+
+        for (int exchange = 0; exchange < 6; exchange++)
+        {
+            text += kCharacters[(scene + exchange) % 4];
+            text += "\n";
+            if (exchange % 3 == 0)
+                text += "(quietly)\n";
+            text += "You said it would be over by now. Line " + std::to_string(lines) + " says otherwise.\n\n";
+            lines += exchange % 3 == 0 ? 4 : 3;
+        }
+    }
+
+    return text;
+}
+
+// A small deterministic generator, standard distributions differ between libraries and the
+// corpus has to be identical wherever the benchmarks run so results can be compared.
+class CorpusRandom {
+public:
+    explicit CorpusRandom(uint64_t seed) : mState(seed) {}
+
+    uint64_t Next()
+    {
+        // splitmix64
+        uint64_t z = (mState += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    std::size_t Below(std::size_t bound) { return bound ? static_cast<std::size_t>(Next() % bound) : 0; }
+    bool Percent(int percent) { return static_cast<int>(Below(100)) < percent; }
+
+private:
+    uint64_t mState;
+};
+
+// Builds a screenplay of roughly the given number of pages in the JSON rich text format.
+// styleDensity is the percentage of paragraphs that carry inline styling, from plain text at
+// 0 to every paragraph split into bold, italic, underlined and colored spans at 100. The same
+// arguments always produce the same document.
+inline std::string MakeScreenplayJSON(int pages, int styleDensity, uint64_t seed = 1)
+{
+    static const char* const kCharacters[] = {"MARGARET", "DETECTIVE RUIZ", "THE STRANGER (V.O.)", "OWEN", "ELENA (CONT'D)"};
+    static const char* const kLocations[] = {"INT. HOUSE - NIGHT", "EXT. HARBOR - DAY", "INT. PRECINCT - CONTINUOUS", "EXT. ROOFTOP - DAWN"};
+    static const char* const kParentheticals[] = {"(quietly)", "(beat)", "(into phone)", "(turning away)"};
+    static const char* const kWords[] = {"rain", "door", "the", "footsteps", "slowly", "she", "harbor", "never", "light",
+        "a", "window", "he", "over", "stairs", "knows", "dark", "cold", "waits", "and", "listens"};
+    static const char* const kColors[] = {"#336699", "#CC3333", "#2E8B57", "#8844AA"};
+
+    CorpusRandom random(seed);
+    auto sentence = [&random](int words) {
+        std::string text;
+        for (int i = 0; i < words; i++)
+        {
+            if (i) text += ' ';
+            text += kWords[random.Below(std::size(kWords))];
+        }
+        text[0] = static_cast<char>(text[0] - 'a' + 'A');
+        return text + '.';
+    };
+
+    auto children = nlohmann::json::array();
+    auto paragraph = [&](const std::string& text, bool bold, bool italic) {
+        nlohmann::json block;
+        if (!random.Percent(styleDensity))
+        {
+            block["text"] = text + "\n";
+            if (bold) block["bold"] = true;
+            if (italic) block["italic"] = true;
+            children.push_back(std::move(block));
+            return;
+        }
+
+        // Split the paragraph into a few spans with their own styles, nested the way the
+        // editor writes them.
+        auto spans = nlohmann::json::array();
+        std::size_t start = 0;
+        while (start < text.size())
+        {
+            auto length = std::min(text.size() - start, 8 + random.Below(24));
+            nlohmann::json span{{"text", text.substr(start, length)}};
+            switch (random.Below(5))
+            {
+            case 0: span["bold"] = true; break;
+            case 1: span["italic"] = true; break;
+            case 2: span["underline"] = true; break;
+            case 3: span["color"] = kColors[random.Below(std::size(kColors))]; break;
+            default: break;
+            }
+            spans.push_back(std::move(span));
+            start += length;
+        }
+        spans.push_back(nlohmann::json{{"text", "\n"}});
+
+        if (bold) block["bold"] = true;
+        if (italic) block["italic"] = true;
+        block["children"] = std::move(spans);
+        children.push_back(std::move(block));
+    };
+
+    int lines = 0;
+    for (int scene = 0; lines < pages * 55; scene++)
+    {
+        paragraph(std::string(kLocations[random.Below(std::size(kLocations))]) + " " + std::to_string(scene), true, false);
+        paragraph("", false, false);
+        paragraph(sentence(8 + static_cast<int>(random.Below(30))), false, false);
+        paragraph("", false, false);
+        lines += 6;
+
+        auto exchanges = 3 + static_cast<int>(random.Below(6));
+        for (int exchange = 0; exchange < exchanges; exchange++)
+        {
+            paragraph(kCharacters[random.Below(std::size(kCharacters))], false, false);
+            if (random.Percent(30))
+            {
+                paragraph(kParentheticals[random.Below(std::size(kParentheticals))], false, true);
+                lines++;
+            }
+            auto dialogue = sentence(4 + static_cast<int>(random.Below(24)));
+            paragraph(dialogue, false, false);
+            paragraph("", false, false);
+            lines += 3 + static_cast<int>(dialogue.size() / 35);
+        }
+    }
+
+    return nlohmann::json{{"children", std::move(children)}}.dump();
+}
@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include "RichTextDocument.h"
+#include "ScriptEditing.h"
+#include "script.hpp"
+
+// Classifying a whole script from scratch, what every keystroke would cost without the
+// change journal.
+static void BM_ScriptClassifier_Full(benchmark::State& state)
+{
+    RichTextDocument doc;
+    ScriptClassifier classifier(&doc);
+    LoadScreenplay(doc, classifier, static_cast<int>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        classifier.SetDocument(&doc);
+        classifier.Update();
+    }
+    state.counters["paragraphs"] = static_cast<double>(classifier.GetLastClassifiedCount());
+}
+
+// Classifies again after an edit halfway through the script, counting the paragraphs it took.
+static void ClassifyAfterTyping(benchmark::State& state, const char* text)
+{
+    RichTextDocument doc;
+    ScriptClassifier classifier(&doc);
+    auto offset = LoadScreenplay(doc, classifier, static_cast<int>(state.range(0))) + 3;
+
+    auto classified = TypeAndTakeBack(state, doc, offset, text, [&classifier] {
+        classifier.Update();
+        return classifier.GetLastClassifiedCount();
+    });
+    state.counters["paragraphs"] = benchmark::Counter(static_cast<double>(classified), benchmark::Counter::kAvgIterations);
+}
+
+// Typing into dialogue, one character per iteration with every other one taken back.
+// Includes the edit itself.
+static void BM_ScriptClassifier_Keystroke(benchmark::State& state)
+{
+    ClassifyAfterTyping(state, "a");
+}
+
+// Splitting a paragraph in two, the new paragraph's successor is classified again as well.
+static void BM_ScriptClassifier_Newline(benchmark::State& state)
+{
+    ClassifyAfterTyping(state, "\n");
+}
+
+BENCHMARK(BM_ScriptClassifier_Full)->Apply(ScreenplayPages)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ScriptClassifier_Keystroke)->Apply(ScreenplayPages)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ScriptClassifier_Newline)->Apply(ScreenplayPages)->Unit(benchmark::kMicrosecond);
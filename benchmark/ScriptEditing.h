@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include <benchmark/benchmark.h>
+
+#include "RichTextCorpus.h"
+#include "RichTextDocument.h"
+#include "script.hpp"
+
+// Screenplay lengths in pages, from a scene to a feature.
+inline void ScreenplayPages(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->Arg(1)->Arg(30)->Arg(300);
+}
+
+inline const ScriptClassifier& GetScriptClassifier(const ScriptClassifier& classifier) { return classifier; }
+inline const ScriptClassifier& GetScriptClassifier(const ScriptPaginator& paginator) { return paginator.GetClassifier(); }
+
+// Loads a screenplay, brings script (a classifier or paginator) up to date and returns the
+// start of a dialogue paragraph halfway through it.
+template <typename Script>
+std::size_t LoadScreenplay(RichTextDocument& doc, Script& script, int pages)
+{
+    doc.Insert(0, MakeScreenplayText(pages));
+    script.Update();
+
+    const auto& classifier = GetScriptClassifier(script);
+    for (auto paragraph = classifier.GetParagraphCount() / 2; paragraph < classifier.GetParagraphCount(); paragraph++)
+    {
+        if (classifier.GetElement(paragraph) == ScriptWritingState::eDialogue)
+            return doc.GetLineStart(paragraph);
+    }
+    return 0;
+}
+
+// Types text at offset on one iteration and takes it back on the next so the document stays
+// the same size. update runs after every edit, what it returns is summed up and returned.
+template <typename Update>
+std::size_t TypeAndTakeBack(benchmark::State& state, RichTextDocument& doc, std::size_t offset, const char* text, Update update)
+{
+    const auto length = std::strlen(text);
+
+    std::size_t total = 0;
+    auto typed = false;
+    for (auto _ : state)
+    {
+        if (typed)
+            doc.Remove(offset, offset + length);
+        else
+            doc.Insert(offset, text);
+        typed = !typed;
+
+        total += update();
+    }
+    return total;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+
+#include "imgui.h"
+#include "misc/freetype/imgui_freetype.h"
+
+#include "FontGlyphCache.h"
+
+struct ScriptFonts {
+    ImFont* regular;
+    ImFont* bold;
+    ImFont* italic;
+    ImFont* boldItalic;
+    ImFont* emoji;
+};
+
+// Adds the same fonts main does: the four Courier Prime faces sharing one Twemoji fallback.
+inline ScriptFonts AddScriptFonts(ImFontAtlas& atlas, FontGlyphCache& glyphCache)
+{
+    ImFontConfig fontCfg;
+    fontCfg.OversampleH = 2;
+    fontCfg.OversampleV = 2;
+
+    ImFontConfig emojiCfg = fontCfg;
+    emojiCfg.FontBuilderFlags |= ImGuiFreeTypeBuilderFlags_LoadColor;
+
+    auto addFace = [&](const char* face) {
+        auto path = std::string(SCRIPTR_RESOURCE_DIR "/CourierPrime-") + face + ".ttf";
+        return atlas.AddFontFromFileTTF(path.c_str(), 18.0f, &fontCfg, glyphCache.GetGlyphRanges());
+    };
+
+    ScriptFonts fonts;
+    fonts.regular = addFace("Regular");
+    fonts.bold = addFace("Bold");
+    fonts.italic = addFace("Italic");
+    fonts.boldItalic = addFace("BoldItalic");
+    fonts.emoji = atlas.AddFontFromFileTTF(SCRIPTR_RESOURCE_DIR "/Twemoji.Mozilla.ttf", 18.0f, &emojiCfg, glyphCache.GetGlyphRanges());
+    glyphCache.SetFallbackFont(fonts.emoji);
+    return fonts;
+}
@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+
+#include "RichTextDocument.h"
+#include "ScriptEditing.h"
+#include "script.hpp"
+
+// Paginating a whole script from scratch, what every keystroke would cost without resuming.
+static void BM_ScriptPaginator_Full(benchmark::State& state)
+{
+    RichTextDocument doc;
+    ScriptPaginator paginator(&doc);
+    LoadScreenplay(doc, paginator, static_cast<int>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        paginator.SetDocument(&doc);
+        paginator.Update();
+    }
+    state.counters["pages"] = static_cast<double>(paginator.GetPageCount());
+}
+
+// Typing into dialogue halfway through the script and asking for "page X of Y" afterwards.
+static void BM_ScriptPaginator_Keystroke(benchmark::State& state)
+{
+    RichTextDocument doc;
+    ScriptPaginator paginator(&doc);
+    auto offset = LoadScreenplay(doc, paginator, static_cast<int>(state.range(0))) + 3;
+
+    auto paginated = TypeAndTakeBack(state, doc, offset, "a", [&] {
+        paginator.Update();
+        benchmark::DoNotOptimize(paginator.GetPageAt(doc.GetLineAt(offset)));
+        benchmark::DoNotOptimize(paginator.GetPageCount());
+        return paginator.GetLastPaginatedCount();
+    });
+    state.counters["paginated"] = benchmark::Counter(static_cast<double>(paginated), benchmark::Counter::kAvgIterations);
+}
+
+// Adding and removing a line of dialogue, which pushes every later break down by a line
+// until the pages absorb it.
+static void BM_ScriptPaginator_Newline(benchmark::State& state)
+{
+    RichTextDocument doc;
+    ScriptPaginator paginator(&doc);
+    auto offset = LoadScreenplay(doc, paginator, static_cast<int>(state.range(0))) + 3;
+
+    auto paginated = TypeAndTakeBack(state, doc, offset, "\n", [&paginator] {
+        paginator.Update();
+        return paginator.GetLastPaginatedCount();
+    });
+    state.counters["paginated"] = benchmark::Counter(static_cast<double>(paginated), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_ScriptPaginator_Full)->Apply(ScreenplayPages)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ScriptPaginator_Keystroke)->Apply(ScreenplayPages)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ScriptPaginator_Newline)->Apply(ScreenplayPages)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,169 @@
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "RichTextCorpus.h"
+#include "StoryGraphAnalysis.h"
+#include "StoryRuntime.h"
+
+// A branching story: every scene offers two options, each leading to a scene a little further
+// on and now and then back to an earlier one, which makes loops. Node 0 starts the story.
+static void MakeBranchingStory(StoryGraph& graph, std::size_t scenes, std::vector<int>& options, int backLinkPercent = 5)
+{
+    std::vector<int> sceneNodes;
+    for (std::size_t i = 0; i < scenes; i++)
+        sceneNodes.push_back(graph.insert_node(Node(NodeType::Script)));
+
+    CorpusRandom random(5);
+    options.clear();
+    for (std::size_t i = 0; i + 1 < scenes; i++)
+    {
+        for (int choice = 0; choice < 2; choice++)
+        {
+            auto option = graph.insert_node(Node(NodeType::Option));
+            options.push_back(option);
+            graph.insert_edge(sceneNodes[i], option);
+
+            auto target = random.Percent(backLinkPercent) ? random.Below(i + 1) : std::min(scenes - 1, i + 1 + random.Below(20));
+            graph.insert_edge(option, sceneNodes[target]);
+        }
+    }
+}
+
+static void BM_StoryGraph_Analyze(benchmark::State& state)
+{
+    StoryGraph graph;
+    std::vector<int> options;
+    MakeBranchingStory(graph, static_cast<std::size_t>(state.range(0)), options);
+
+    for (auto _ : state)
+    {
+        StoryGraphAnalysis analysis(&graph);
+        analysis.SetStartNode(graph.nodes()[0]);
+        analysis.Update();
+        benchmark::DoNotOptimize(analysis.GetLongestEnding());
+    }
+    state.counters["nodes"] = static_cast<double>(graph.nodes().size());
+}
+
+// A writer linking an option to another scene, with the Inspector's counts read afterwards.
+// With paths the shortest and longest endings are read too, which walks the whole graph.
+static void BM_StoryGraph_AddLink(benchmark::State& state)
+{
+    StoryGraph graph;
+    std::vector<int> options;
+    MakeBranchingStory(graph, static_cast<std::size_t>(state.range(0)), options);
+    auto withPaths = state.range(1) != 0;
+
+    StoryGraphAnalysis analysis(&graph);
+    analysis.SetStartNode(graph.nodes()[0]);
+    analysis.Update();
+
+    CorpusRandom random(6);
+    std::size_t full = 0;
+    for (auto _ : state)
+    {
+        // Options sit after the scenes, link forward so the order of the loops holds.
+        auto option = random.Below(options.size());
+        auto scene = graph.edge(graph.outgoing_edges(options[option])[0]).to;
+        graph.insert_edge(options[option], scene);
+        analysis.Update();
+        full += analysis.WasLastUpdateFull();
+        benchmark::DoNotOptimize(analysis.GetUnreachableCount());
+        if (withPaths)
+            benchmark::DoNotOptimize(analysis.GetLongestEnding());
+    }
+    state.counters["full"] = static_cast<double>(full);
+}
+
+// Removing a link and putting it back, only the removal is timed.
+static void BM_StoryGraph_RemoveLink(benchmark::State& state)
+{
+    StoryGraph graph;
+    std::vector<int> options;
+    MakeBranchingStory(graph, static_cast<std::size_t>(state.range(0)), options);
+
+    StoryGraphAnalysis analysis(&graph);
+    analysis.SetStartNode(graph.nodes()[0]);
+    analysis.Update();
+
+    CorpusRandom random(7);
+    for (auto _ : state)
+    {
+        auto option = options[random.Below(options.size())];
+        auto edge = graph.edge(graph.outgoing_edges(option)[0]);
+        graph.erase_edge(edge.id);
+        analysis.Update();
+        benchmark::DoNotOptimize(analysis.GetUnreachableCount());
+
+        state.PauseTiming();
+        graph.insert_edge(edge.from, edge.to);
+        analysis.Update();
+        state.ResumeTiming();
+    }
+}
+
+static void BM_StoryRuntime_Compile(benchmark::State& state)
+{
+    StoryGraph graph;
+    std::vector<int> options;
+    MakeBranchingStory(graph, static_cast<std::size_t>(state.range(0)), options);
+
+    StoryRuntime runtime;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(runtime.Compile(graph, graph.nodes()[0]));
+    state.counters["nodes"] = static_cast<double>(runtime.GetNodeCount());
+}
+
+// Random playthroughs of a story without loops, on one thread and on every core (jobs 0).
+static void BM_StoryRuntime_PlayRandom(benchmark::State& state)
+{
+    StoryGraph graph;
+    std::vector<int> options;
+    MakeBranchingStory(graph, static_cast<std::size_t>(state.range(0)), options, 0);
+
+    StoryRuntime runtime;
+    runtime.Compile(graph, graph.nodes()[0]);
+    StoryRunSettings settings;
+    settings.jobs = static_cast<int>(state.range(1));
+
+    constexpr uint64_t kPlaythroughs = 1 << 20;
+    StoryReport report;
+    for (auto _ : state)
+    {
+        report = runtime.PlayRandom(kPlaythroughs, settings);
+        benchmark::DoNotOptimize(report.finished);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kPlaythroughs));
+    state.counters["length"] = report.GetAverageLength();
+    state.counters["paths"] = static_cast<double>(report.distinctPaths);
+}
+
+// Every path through a short story.
+static void BM_StoryRuntime_PlayAll(benchmark::State& state)
+{
+    StoryGraph graph;
+    std::vector<int> options;
+    MakeBranchingStory(graph, static_cast<std::size_t>(state.range(0)), options, 0);
+
+    StoryRuntime runtime;
+    runtime.Compile(graph, graph.nodes()[0]);
+    StoryRunSettings settings;
+    settings.jobs = static_cast<int>(state.range(1));
+
+    StoryReport report;
+    for (auto _ : state)
+    {
+        report = runtime.PlayAll(settings);
+        benchmark::DoNotOptimize(report.finished);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * report.playthroughs));
+    state.counters["paths"] = static_cast<double>(report.playthroughs);
+}
+
+BENCHMARK(BM_StoryGraph_Analyze)->Arg(10000)->Arg(50000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_StoryGraph_AddLink)->ArgNames({"scenes", "paths"})->ArgsProduct({{10000, 50000}, {0, 1}})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_StoryGraph_RemoveLink)->Arg(10000)->Arg(50000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_StoryRuntime_Compile)->Arg(10000)->Arg(50000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_StoryRuntime_PlayRandom)->ArgNames({"scenes", "jobs"})->ArgsProduct({{100, 1000}, {1, 0}})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_StoryRuntime_PlayAll)->ArgNames({"scenes", "jobs"})->ArgsProduct({{100, 150}, {1, 0}})->Unit(benchmark::kMillisecond)->UseRealTime();
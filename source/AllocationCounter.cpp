@@ -0,0 +1,153 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "imgui.h"
+
+#include "AllocationCounter.h"
+
+#if !defined(NDEBUG) || defined(SCRIPTR_COUNT_ALLOCATIONS)
+
+static std::atomic<std::size_t> sAllocationCount{0};
+static std::atomic<std::size_t> sLiveBytes{0};
+static std::atomic<std::size_t> sPeakBytes{0};
+
+// Each block starts with its size so delete can take it off the live bytes, the header
+// keeps the block after it aligned like malloc's.
+static constexpr std::size_t kHeaderSize = alignof(std::max_align_t);
+
+static void AddLiveBytes(std::size_t size)
+{
+    auto live = sLiveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    auto peak = sPeakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !sPeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        ;
+}
+
+static void* CountedAllocate(std::size_t size)
+{
+    sAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (size > SIZE_MAX - kHeaderSize)
+        throw std::bad_alloc();
+
+    while (true)
+    {
+        if (void* block = std::malloc(kHeaderSize + size))
+        {
+            *static_cast<std::size_t*>(block) = size;
+            AddLiveBytes(size);
+            return static_cast<char*>(block) + kHeaderSize;
+        }
+
+        auto handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new(std::size_t size) { return CountedAllocate(size); }
+void* operator new[](std::size_t size) { return CountedAllocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return CountedAllocate(size); }
+    catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return CountedAllocate(size); }
+    catch (...) { return nullptr; }
+}
+
+static void CountedFree(void* pointer)
+{
+    if (!pointer)
+        return;
+
+    void* block = static_cast<char*>(pointer) - kHeaderSize;
+    sLiveBytes.fetch_sub(*static_cast<std::size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete(void* pointer) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer) noexcept { CountedFree(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { CountedFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { CountedFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { CountedFree(pointer); }
+
+// ImGui allocates through malloc by default, so its blocks can be freed either way.
+static void* CountedImGuiAllocate(std::size_t size, void*)
+{
+    sAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size);
+}
+
+static void ImGuiFree(void* pointer, void*)
+{
+    std::free(pointer);
+}
+
+void AllocationCounter::CountImGuiAllocations()
+{
+    ImGui::SetAllocatorFunctions(CountedImGuiAllocate, ImGuiFree);
+}
+
+std::size_t AllocationCounter::GetAllocationCount()
+{
+    return sAllocationCount.load(std::memory_order_relaxed);
+}
+
+bool AllocationCounter::IsEnabled()
+{
+    return true;
+}
+
+std::size_t AllocationCounter::GetLiveBytes()
+{
+    return sLiveBytes.load(std::memory_order_relaxed);
+}
+
+std::size_t AllocationCounter::GetPeakBytes()
+{
+    return sPeakBytes.load(std::memory_order_relaxed);
+}
+
+void AllocationCounter::ResetPeakBytes()
+{
+    sPeakBytes.store(sLiveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+#else
+
+std::size_t AllocationCounter::GetAllocationCount()
+{
+    return 0;
+}
+
+bool AllocationCounter::IsEnabled()
+{
+    return false;
+}
+
+std::size_t AllocationCounter::GetLiveBytes()
+{
+    return 0;
+}
+
+std::size_t AllocationCounter::GetPeakBytes()
+{
+    return 0;
+}
+
+void AllocationCounter::ResetPeakBytes()
+{
+}
+
+void AllocationCounter::CountImGuiAllocations()
+{
+}
+
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts calls to the global operator new and, once CountImGuiAllocations has run, ImGui's
+// IM_ALLOC. Bytes are tracked for operator new only. Only debug builds, or builds defining SCRIPTR_COUNT_ALLOCATIONS like the
+// benchmarks, replace the allocation functions, release builds always report zero.
+class AllocationCounter {
+public:
+    static std::size_t GetAllocationCount();
+    static bool IsEnabled();
+
+    // Bytes held through operator new right now, and the most held since ResetPeakBytes.
+    static std::size_t GetLiveBytes();
+    static std::size_t GetPeakBytes();
+    static void ResetPeakBytes(); // The peak starts again from the live bytes.
+
+    // Routes ImGui's allocations through the counter, call before creating a context.
+    static void CountImGuiAllocations();
+};
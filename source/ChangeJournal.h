@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Remembers the most recent edits to something so whatever is derived from it can catch up
+// instead of rebuilding. Every edit bumps the version. Only a bounded window of edits is
+// kept, anyone further behind simply rebuilds.
+template <typename Change>
+class ChangeJournal {
+public:
+    explicit ChangeJournal(std::size_t maxRecorded)
+        : mMaxRecorded(maxRecorded)
+    {
+    }
+
+    uint64_t GetVersion() const { return mVersion; }
+
+    // Returns false when the changes since version are no longer recorded, in that case
+    // everything derived must be rebuilt.
+    bool GetChangesSince(uint64_t version, std::vector<Change>& changes) const
+    {
+        changes.clear();
+        if (version < mFirstVersion || version > mVersion)
+            return false;
+
+        changes.insert(changes.end(), mChanges.begin() + static_cast<std::ptrdiff_t>(version - mFirstVersion), mChanges.end());
+        return true;
+    }
+
+    void Record(const Change& change)
+    {
+        // Halving rather than dropping one at a time keeps recording amortized O(1).
+        if (mChanges.size() >= mMaxRecorded)
+        {
+            auto dropped = mChanges.size() / 2;
+            mChanges.erase(mChanges.begin(), mChanges.begin() + static_cast<std::ptrdiff_t>(dropped));
+            mFirstVersion += dropped;
+        }
+
+        mChanges.push_back(change);
+        mVersion++;
+    }
+
+    // Forgets every change, anyone behind the new version rebuilds.
+    void Reset()
+    {
+        mChanges.clear();
+        mFirstVersion = ++mVersion;
+    }
+
+private:
+    // mChanges[i] moved things from version mFirstVersion + i.
+    std::vector<Change> mChanges;
+    std::size_t mMaxRecorded;
+    uint64_t mFirstVersion = 0;
+    uint64_t mVersion = 0;
+};
@@ -0,0 +1,390 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/SharedMemory.h>
+
+#include "imgui.h"
+#include "imgui_internal.h"
+
+#include "FontAtlasCache.h"
+#include "FontGlyphCache.h"
+
+static constexpr char kMagic[8] = {'S', 'C', 'R', 'A', 'T', 'L', 'A', 'S'};
+static constexpr uint32_t kFormatVersion = 1;
+
+enum FontAtlasCachePixels : uint32_t {
+    FontAtlasCachePixels_Alpha8 = 0x1,
+    FontAtlasCachePixels_RGBA32 = 0x2,
+    FontAtlasCachePixels_UseColors = 0x4,
+};
+
+struct FontAtlasCacheHeader {
+    char magic[8];
+    uint64_t key;
+    int32_t texWidth;
+    int32_t texHeight;
+    uint32_t pixels;
+    int32_t fontCount;
+    int32_t customRectCount;
+    int32_t rangeCount;
+};
+
+struct FontAtlasCacheFont {
+    float fontSize;
+    float ascent;
+    float descent;
+    int32_t metricsTotalSurface;
+    int32_t glyphCount;
+};
+
+static uint64_t MixWord(uint64_t hash, uint64_t word)
+{
+    hash = (hash ^ word) * 0x100000001B3ull;
+    return hash ^ (hash >> 29);
+}
+
+// Font files are megabytes and get hashed on every launch, so the bulk is mixed in four
+// independent lanes of eight bytes that the CPU can work on in parallel.
+static uint64_t HashBytes(uint64_t hash, const void* data, std::size_t size)
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    uint64_t lanes[4] = {hash, hash ^ 0x9E3779B97F4A7C15ull, hash ^ 0xC2B2AE3D27D4EB4Full, hash ^ 0x165667B19E3779F9ull};
+    for (; size >= 32; size -= 32, bytes += 32)
+    {
+        uint64_t words[4];
+        std::memcpy(words, bytes, sizeof(words));
+        for (int i = 0; i < 4; i++)
+            lanes[i] = MixWord(lanes[i], words[i]);
+    }
+
+    hash = MixWord(MixWord(MixWord(lanes[0], lanes[1]), lanes[2]), lanes[3]);
+    for (; size > 0; size--, bytes++)
+        hash = (hash ^ *bytes) * 0x100000001B3ull;
+    return hash;
+}
+
+template <typename T>
+static uint64_t HashValue(uint64_t hash, const T& value)
+{
+    return HashBytes(hash, &value, sizeof(value));
+}
+
+static bool UsesGlyphCache(const ImFontConfig& config, const FontGlyphCache* glyphCache)
+{
+    return glyphCache && config.GlyphRanges == glyphCache->GetGlyphRanges();
+}
+
+uint64_t FontAtlasCache::ComputeKey(ImFontAtlas* atlas, const FontGlyphCache* glyphCache)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash = HashValue(hash, kFormatVersion);
+    hash = HashValue(hash, IMGUI_VERSION_NUM);
+    hash = HashValue(hash, sizeof(ImFontGlyph));
+    hash = HashValue(hash, sizeof(ImWchar));
+#ifdef IMGUI_ENABLE_FREETYPE
+    hash = HashValue(hash, 'F');
+#endif
+    hash = HashValue(hash, atlas->Flags);
+    hash = HashValue(hash, atlas->TexDesiredWidth);
+    hash = HashValue(hash, atlas->TexGlyphPadding);
+    hash = HashValue(hash, atlas->FontBuilderFlags);
+    hash = HashValue(hash, atlas->Fonts.Size);
+
+    for (const auto& config : atlas->ConfigData)
+    {
+        hash = HashBytes(hash, config.FontData, static_cast<std::size_t>(config.FontDataSize));
+        hash = HashValue(hash, config.FontNo);
+        hash = HashValue(hash, config.SizePixels);
+        hash = HashValue(hash, config.OversampleH);
+        hash = HashValue(hash, config.OversampleV);
+        hash = HashValue(hash, config.PixelSnapH);
+        hash = HashValue(hash, config.GlyphExtraSpacing);
+        hash = HashValue(hash, config.GlyphOffset);
+        hash = HashValue(hash, config.GlyphMinAdvanceX);
+        hash = HashValue(hash, config.GlyphMaxAdvanceX);
+        hash = HashValue(hash, config.MergeMode);
+        hash = HashValue(hash, config.FontBuilderFlags);
+        hash = HashValue(hash, config.RasterizerMultiply);
+        hash = HashValue(hash, config.RasterizerDensity);
+        hash = HashValue(hash, config.EllipsisChar);
+
+        // Ranges owned by the glyph cache are stored in the file instead.
+        const bool cached = UsesGlyphCache(config, glyphCache);
+        hash = HashValue(hash, cached);
+        if (!cached)
+        {
+            const ImWchar* ranges = config.GlyphRanges ? config.GlyphRanges : atlas->GetGlyphRangesDefault();
+            for (; *ranges; ranges++)
+                hash = HashValue(hash, *ranges);
+        }
+    }
+
+    return hash;
+}
+
+// Bounds checked reads out of the mapped file.
+class FontAtlasCacheReader {
+public:
+    FontAtlasCacheReader(const char* data, std::size_t size)
+        : mCurrent(data), mEnd(data + size)
+    {
+    }
+
+    bool Read(void* out, std::size_t size)
+    {
+        auto data = Take(size);
+        if (data && size != 0) std::memcpy(out, data, size);
+        return data != nullptr;
+    }
+
+    // Points straight into the file, nullptr when it is too short.
+    const char* Take(std::size_t size)
+    {
+        if (static_cast<std::size_t>(mEnd - mCurrent) < size) return nullptr;
+        auto data = mCurrent;
+        mCurrent += size;
+        return data;
+    }
+
+    template <typename T>
+    bool Read(T& value) { return Read(&value, sizeof(value)); }
+
+    // Whether count items of size bytes each are left, checked before allocating for them.
+    bool HasRoomFor(std::size_t count, std::size_t size) const
+    {
+        return count <= static_cast<std::size_t>(mEnd - mCurrent) / size;
+    }
+
+    bool AtEnd() const { return mCurrent == mEnd; }
+
+private:
+    const char* mCurrent;
+    const char* mEnd;
+};
+
+static bool Restore(ImFontAtlas* atlas, const char* data, std::size_t size, uint64_t key, FontGlyphCache* glyphCache)
+{
+    FontAtlasCacheReader reader(data, size);
+
+    FontAtlasCacheHeader header;
+    if (!reader.Read(header) || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        return false;
+    if (header.key != key || header.fontCount != atlas->Fonts.Size)
+        return false;
+    if (header.texWidth <= 0 || header.texHeight <= 0 || header.texWidth > 32768 || header.texHeight > 32768 || header.rangeCount < 0)
+        return false;
+    if (header.rangeCount % 2 == 0 && header.rangeCount != 0)
+        return false; // Pairs and a terminator.
+    if (!reader.HasRoomFor(static_cast<std::size_t>(header.rangeCount), sizeof(ImWchar)))
+        return false;
+
+    ImVector<ImWchar> ranges;
+    ranges.resize(header.rangeCount);
+    if (!reader.Read(ranges.Data, ranges.size_in_bytes()) || (!ranges.empty() && ranges.back() != 0))
+        return false;
+
+    const std::size_t customRectCount = static_cast<std::size_t>(std::max(header.customRectCount, 0));
+    if (!reader.HasRoomFor(customRectCount, sizeof(ImFontAtlasCustomRect::X) + sizeof(ImFontAtlasCustomRect::Y)))
+        return false;
+
+    std::vector<ImFontAtlasCustomRect> packedRects(customRectCount);
+    for (auto& rect : packedRects)
+    {
+        if (!reader.Read(rect.X) || !reader.Read(rect.Y))
+            return false;
+    }
+
+    std::vector<FontAtlasCacheFont> fonts(static_cast<std::size_t>(header.fontCount));
+    std::vector<ImVector<ImFontGlyph>> glyphs(fonts.size());
+    for (std::size_t i = 0; i < fonts.size(); i++)
+    {
+        if (!reader.Read(fonts[i]) || fonts[i].glyphCount <= 0)
+            return false;
+        if (!reader.HasRoomFor(static_cast<std::size_t>(fonts[i].glyphCount), sizeof(ImFontGlyph)))
+            return false;
+        glyphs[i].resize(fonts[i].glyphCount);
+        if (!reader.Read(glyphs[i].Data, glyphs[i].size_in_bytes()))
+            return false;
+        for (const auto& glyph : glyphs[i])
+        {
+            if (glyph.Codepoint > IM_UNICODE_CODEPOINT_MAX)
+                return false;
+        }
+    }
+
+    const std::size_t pixelCount = static_cast<std::size_t>(header.texWidth) * header.texHeight;
+    const char* alpha8 = nullptr;
+    const char* rgba32 = nullptr;
+    if ((header.pixels & FontAtlasCachePixels_Alpha8) && !(alpha8 = reader.Take(pixelCount)))
+        return false;
+    if ((header.pixels & FontAtlasCachePixels_RGBA32) && !(rgba32 = reader.Take(pixelCount * 4)))
+        return false;
+    if ((!alpha8 && !rgba32) || !reader.AtEnd())
+        return false;
+
+    // The default rectangles are registered the same way a build would, they must match
+    // what was packed last time. Custom glyph rectangles are not supported.
+    ImFontAtlasBuildInit(atlas);
+    if (atlas->CustomRects.Size != header.customRectCount)
+        return false;
+    for (int i = 0; i < atlas->CustomRects.Size; i++)
+    {
+        const auto& rect = atlas->CustomRects[i];
+        if (rect.Font != nullptr)
+            return false;
+        if (packedRects[i].X + rect.Width > header.texWidth || packedRects[i].Y + rect.Height > header.texHeight)
+            return false;
+    }
+
+    // Everything checks out, install it as if the builder had just produced it.
+    atlas->ClearTexData();
+    atlas->TexWidth = header.texWidth;
+    atlas->TexHeight = header.texHeight;
+    atlas->TexUvScale = ImVec2(1.0f / atlas->TexWidth, 1.0f / atlas->TexHeight);
+    atlas->TexPixelsUseColors = (header.pixels & FontAtlasCachePixels_UseColors) != 0;
+
+    // The atlas owns and later frees its pixels, so they are copied out of the mapping.
+    if (alpha8)
+    {
+        atlas->TexPixelsAlpha8 = static_cast<unsigned char*>(IM_ALLOC(pixelCount));
+        std::memcpy(atlas->TexPixelsAlpha8, alpha8, pixelCount);
+    }
+    if (rgba32)
+    {
+        atlas->TexPixelsRGBA32 = static_cast<unsigned int*>(IM_ALLOC(pixelCount * 4));
+        std::memcpy(atlas->TexPixelsRGBA32, rgba32, pixelCount * 4);
+    }
+
+    for (int i = 0; i < atlas->CustomRects.Size; i++)
+    {
+        atlas->CustomRects[i].X = packedRects[i].X;
+        atlas->CustomRects[i].Y = packedRects[i].Y;
+    }
+
+    for (int i = 0; i < atlas->Fonts.Size; i++)
+    {
+        ImFont* font = atlas->Fonts[i];
+        auto config = &atlas->ConfigData[static_cast<int>(font->ConfigData - atlas->ConfigData.Data)];
+        ImFontAtlasBuildSetupFont(atlas, font, config, fonts[i].ascent, fonts[i].descent);
+        font->FontSize = fonts[i].fontSize;
+        font->MetricsTotalSurface = fonts[i].metricsTotalSurface;
+        font->Glyphs.swap(glyphs[i]);
+        font->DirtyLookupTables = true;
+    }
+
+    ImFontAtlasBuildFinish(atlas);
+
+    if (glyphCache && !ranges.empty())
+        glyphCache->Restore(ranges.Data);
+
+    return true;
+}
+
+bool FontAtlasCache::Load(ImFontAtlas* atlas, const std::string& path, FontGlyphCache* glyphCache)
+{
+    return Load(atlas, path, ComputeKey(atlas, glyphCache), glyphCache);
+}
+
+bool FontAtlasCache::Load(ImFontAtlas* atlas, const std::string& path, uint64_t key, FontGlyphCache* glyphCache)
+{
+    if (atlas->Fonts.empty() || atlas->Locked)
+        return false;
+
+    try
+    {
+        Poco::File file(path);
+        if (!file.exists() || file.getSize() < sizeof(FontAtlasCacheHeader))
+            return false;
+
+        Poco::SharedMemory memory(file, Poco::SharedMemory::AM_READ);
+        return Restore(atlas, memory.begin(), static_cast<std::size_t>(memory.end() - memory.begin()), key, glyphCache);
+    }
+    catch (const Poco::Exception&)
+    {
+        return false;
+    }
+}
+
+bool FontAtlasCache::Save(ImFontAtlas* atlas, const std::string& path, const FontGlyphCache* glyphCache)
+{
+    return Save(atlas, path, ComputeKey(atlas, glyphCache), glyphCache);
+}
+
+bool FontAtlasCache::Save(ImFontAtlas* atlas, const std::string& path, uint64_t key, const FontGlyphCache* glyphCache)
+{
+    if (!atlas->IsBuilt() || (!atlas->TexPixelsAlpha8 && !atlas->TexPixelsRGBA32))
+        return false;
+
+    for (const auto& rect : atlas->CustomRects)
+    {
+        if (rect.Font != nullptr)
+            return false;
+    }
+
+    int rangeCount = 0;
+    if (glyphCache)
+    {
+        while (glyphCache->GetGlyphRanges()[rangeCount]) rangeCount++;
+        rangeCount++;
+    }
+
+    FontAtlasCacheHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.key = key;
+    header.texWidth = atlas->TexWidth;
+    header.texHeight = atlas->TexHeight;
+    header.pixels = (atlas->TexPixelsAlpha8 ? static_cast<uint32_t>(FontAtlasCachePixels_Alpha8) : 0u)
+        | (atlas->TexPixelsRGBA32 ? static_cast<uint32_t>(FontAtlasCachePixels_RGBA32) : 0u)
+        | (atlas->TexPixelsUseColors ? static_cast<uint32_t>(FontAtlasCachePixels_UseColors) : 0u);
+    header.fontCount = atlas->Fonts.Size;
+    header.customRectCount = atlas->CustomRects.Size;
+    header.rangeCount = rangeCount;
+
+    // Written next to the target and renamed over it, a crash never leaves half a file.
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!stream) return false;
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (glyphCache)
+            stream.write(reinterpret_cast<const char*>(glyphCache->GetGlyphRanges()), rangeCount * sizeof(ImWchar));
+
+        for (const auto& rect : atlas->CustomRects)
+        {
+            stream.write(reinterpret_cast<const char*>(&rect.X), sizeof(rect.X));
+            stream.write(reinterpret_cast<const char*>(&rect.Y), sizeof(rect.Y));
+        }
+
+        for (const ImFont* font : atlas->Fonts)
+        {
+            FontAtlasCacheFont metrics{font->FontSize, font->Ascent, font->Descent, font->MetricsTotalSurface, font->Glyphs.Size};
+            stream.write(reinterpret_cast<const char*>(&metrics), sizeof(metrics));
+            stream.write(reinterpret_cast<const char*>(font->Glyphs.Data), font->Glyphs.size_in_bytes());
+        }
+
+        const std::size_t pixelCount = static_cast<std::size_t>(atlas->TexWidth) * atlas->TexHeight;
+        if (atlas->TexPixelsAlpha8)
+            stream.write(reinterpret_cast<const char*>(atlas->TexPixelsAlpha8), pixelCount);
+        if (atlas->TexPixelsRGBA32)
+            stream.write(reinterpret_cast<const char*>(atlas->TexPixelsRGBA32), pixelCount * 4);
+
+        if (!stream) return false;
+    }
+
+    try
+    {
+        Poco::File(temporaryPath).renameTo(path);
+    }
+    catch (const Poco::Exception&)
+    {
+        return false;
+    }
+
+    return true;
+}
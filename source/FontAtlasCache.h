@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "imgui.h"
+
+class FontGlyphCache;
+
+// Saves a built font atlas to disk and restores it on later launches so a warm start never
+// runs the rasterizer. The file is keyed on everything that affects the result: a hash of
+// every font file, sizes, rasterizer density, oversampling and builder flags. Any change
+// simply misses and the atlas gets built as usual.
+//
+// Fonts whose glyph ranges come from a glyph cache are keyed without their ranges, the file
+// remembers the glyphs that were rasterized and the cache picks them up again on load.
+class FontAtlasCache {
+public:
+    // Hashes every font file, so callers that save more than once compute it once after
+    // adding the fonts and pass it on. Growing the glyph cache leaves it unchanged.
+    static uint64_t ComputeKey(ImFontAtlas* atlas, const FontGlyphCache* glyphCache = nullptr);
+
+    // Restores the atlas from path, fonts must already be added. Returns false when there
+    // is no usable file, the atlas can then be built as usual. At most its default
+    // rectangles have been registered, which the build does anyway.
+    static bool Load(ImFontAtlas* atlas, const std::string& path, FontGlyphCache* glyphCache = nullptr);
+    static bool Load(ImFontAtlas* atlas, const std::string& path, uint64_t key, FontGlyphCache* glyphCache = nullptr);
+
+    // Writes a built atlas to path.
+    static bool Save(ImFontAtlas* atlas, const std::string& path, const FontGlyphCache* glyphCache = nullptr);
+    static bool Save(ImFontAtlas* atlas, const std::string& path, uint64_t key, const FontGlyphCache* glyphCache = nullptr);
+};
@@ -0,0 +1,129 @@
+#include "imgui.h"
+#include "imgui_internal.h"
+
+#include "FontGlyphCache.h"
+
+// Latin, the punctuation scripts are typed with and the glyphs ImGui itself falls back on.
+static const ImWchar kInitialRanges[] = {
+    0x0020, 0x00FF, // Basic Latin, Latin-1 Supplement
+    0x2000, 0x206F, // General Punctuation
+    0xFFFD, 0xFFFD, // Replacement character
+    0,
+};
+
+static int CountCodepoints(const ImWchar* ranges)
+{
+    int count = 0;
+    for (; ranges[0]; ranges += 2)
+        count += ranges[1] - ranges[0] + 1;
+    return count;
+}
+
+FontGlyphCache::FontGlyphCache(ImFontAtlas* atlas)
+    : mAtlas(atlas)
+{
+    mCodepoints.AddRanges(kInitialRanges);
+    mCodepoints.BuildRanges(&mRanges);
+    mCodepointCount = CountCodepoints(mRanges.Data);
+}
+
+void FontGlyphCache::Request(std::string_view text)
+{
+    const char* current = text.data();
+    const char* end = current + text.size();
+
+    while (current < end)
+    {
+        unsigned int codepoint = static_cast<unsigned char>(*current);
+        if (codepoint < 0x80)
+            current++;
+        else
+            current += ImTextCharFromUtf8(&codepoint, current, end);
+
+        if (codepoint >= 0x20 && !mCodepoints.GetBit(codepoint))
+            Request(static_cast<ImWchar>(codepoint));
+    }
+}
+
+void FontGlyphCache::Request(ImWchar codepoint)
+{
+    if (mCodepoints.GetBit(codepoint)) return;
+
+    mCodepoints.AddChar(codepoint);
+    mCodepointCount++;
+    mDirty = true;
+}
+
+void FontGlyphCache::Restore(const ImWchar* ranges)
+{
+    const ImWchar* previous = mRanges.Data;
+
+    ImVector<ImWchar> restored;
+    mCodepoints.AddRanges(ranges);
+    mCodepoints.BuildRanges(&restored);
+    mRanges.swap(restored);
+    mCodepointCount = CountCodepoints(mRanges.Data);
+
+    for (auto& config : mAtlas->ConfigData)
+    {
+        if (config.GlyphRanges == previous)
+            config.GlyphRanges = mRanges.Data;
+    }
+}
+
+bool FontGlyphCache::Update()
+{
+    if (!mDirty) return false;
+    mDirty = false;
+
+    ImVector<ImWchar> ranges;
+    mCodepoints.BuildRanges(&ranges);
+    mRanges.swap(ranges);
+
+    // Fonts keep their sources in the atlas, so pointing them at the new ranges and building
+    // again rasterizes only what is needed while every ImFont* stays valid.
+    for (auto& config : mAtlas->ConfigData)
+        config.GlyphRanges = mRanges.Data;
+
+    mAtlas->ClearTexData();
+    mAtlas->Build();
+    ShareFallbackGlyphs();
+    mGeneration++;
+    return true;
+}
+
+void FontGlyphCache::ShareFallbackGlyphs()
+{
+    if (!mFallbackFont) return;
+    const ImFont* fallback = mFallbackFont;
+
+    for (ImFont* font : mAtlas->Fonts)
+    {
+        if (font == fallback) continue;
+
+        // The builder appends a tab glyph last and only recognizes it there, take it off so
+        // the lookup table rebuild below does not add a second one.
+        if (!font->Glyphs.empty() && font->Glyphs.back().Codepoint == '\t')
+            font->Glyphs.pop_back();
+
+        // Glyph quads are relative to the top of the line, move them onto this font's baseline.
+        const float scale = font->FontSize / fallback->FontSize;
+        const float baseline = IM_ROUND(font->Ascent);
+        const float fallbackBaseline = IM_ROUND(fallback->Ascent);
+
+        for (const ImFontGlyph& glyph : fallback->Glyphs)
+        {
+            // Glyphs of the font itself win, as they would when merging.
+            if (glyph.Codepoint == '\t' || font->FindGlyphNoFallback(static_cast<ImWchar>(glyph.Codepoint)))
+                continue;
+
+            font->AddGlyph(nullptr, static_cast<ImWchar>(glyph.Codepoint),
+                glyph.X0 * scale, (glyph.Y0 - fallbackBaseline) * scale + baseline,
+                glyph.X1 * scale, (glyph.Y1 - fallbackBaseline) * scale + baseline,
+                glyph.U0, glyph.V0, glyph.U1, glyph.V1, glyph.AdvanceX * scale);
+            font->Glyphs.back().Colored = glyph.Colored;
+        }
+
+        font->BuildLookupTable();
+    }
+}
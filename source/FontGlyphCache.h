@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "imgui.h"
+
+// Keeps a font atlas down to the glyphs that are actually drawn instead of every codepoint
+// the fonts contain. The atlas starts out with a small default set, text that needs more
+// requests it while being laid out and the atlas is rebuilt with the new glyphs once per
+// frame before ImGui::NewFrame. Fonts keep their ImFont* across rebuilds.
+class FontGlyphCache {
+public:
+    explicit FontGlyphCache(ImFontAtlas* atlas);
+    ~FontGlyphCache() = default;
+
+    // Pass these as the glyph ranges of every font added to the atlas.
+    const ImWchar* GetGlyphRanges() const { return mRanges.Data; }
+
+    // Marks the codepoints in the UTF-8 text as needed. Cheap when they already are.
+    void Request(std::string_view text);
+    void Request(ImWchar codepoint);
+
+    // Rebuilds the atlas when new glyphs were requested. Returns true when it did, the
+    // renderer must then upload the font texture again. Call outside of a frame.
+    bool Update();
+
+    // Takes over ranges an atlas was already built with, e.g. one restored from disk.
+    void Restore(const ImWchar* ranges);
+
+    // Glyphs the other fonts lack are shared from this font instead of merging it into each
+    // of them, so it is rasterized and stored in the atlas only once. Add it as a font of its
+    // own at the same size as the others.
+    void SetFallbackFont(ImFont* font) { mFallbackFont = font; }
+
+    // Copies the fallback glyphs into the other fonts, they point at the same atlas pixels.
+    // Call after the atlas was built or restored, Update does it itself.
+    void ShareFallbackGlyphs();
+
+    // Bumped by every rebuild, layout measured against an older generation is stale.
+    uint32_t GetGeneration() const { return mGeneration; }
+    int GetCodepointCount() const { return mCodepointCount; }
+
+private:
+    ImFontAtlas* mAtlas;
+    ImFont* mFallbackFont = nullptr;
+    ImFontGlyphRangesBuilder mCodepoints;
+    ImVector<ImWchar> mRanges;
+    int mCodepointCount = 0;
+    uint32_t mGeneration = 0;
+    bool mDirty = false;
+};
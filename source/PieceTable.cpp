@@ -0,0 +1,396 @@
+#include <algorithm>
+#include <cassert>
+
+#include "PieceTable.h"
+
+PieceTable::PieceTable()
+{
+}
+
+void PieceTable::AppendOriginal(std::string_view text, uint32_t style)
+{
+    if (text.empty()) return;
+
+    const Piece piece{PieceBuffer::Original, style, mOriginal.size(), text.size()};
+    const std::size_t lineBreaksBefore = mOriginalLineBreaks.size();
+    AppendBuffer(mOriginal, mOriginalLineBreaks, text);
+
+    // Consecutive blocks that resolve to the same style share one piece.
+    if (!ExtendPieceEndingAt(mRoot, GetLength(), piece, mOriginalLineBreaks.size() - lineBreaksBefore))
+        mRoot = Merge(mRoot, AllocateNode(piece));
+}
+
+void PieceTable::LoadOriginal(std::string original, const std::vector<Piece>& pieces)
+{
+    Clear();
+    mOriginal = std::move(original);
+    mNodes.reserve(pieces.size());
+
+    for (auto position = mOriginal.find('\n'); position != std::string::npos; position = mOriginal.find('\n', position + 1))
+        mOriginalLineBreaks.push_back(position);
+
+    for (const auto& piece : pieces)
+    {
+        assert(piece.buffer == PieceBuffer::Original && piece.start + piece.length <= mOriginal.size());
+        if (piece.length > 0)
+            mRoot = Merge(mRoot, AllocateNode(piece));
+    }
+}
+
+std::size_t PieceTable::GetLength() const
+{
+    return SubtreeLength(mRoot);
+}
+
+std::size_t PieceTable::GetLineBreakCount() const
+{
+    return SubtreeLineBreaks(mRoot);
+}
+
+std::string_view PieceTable::GetPieceText(const Piece& piece) const
+{
+    const std::string& buffer = piece.buffer == PieceBuffer::Original ? mOriginal : mAdd;
+    return std::string_view(buffer.data() + piece.start, piece.length);
+}
+
+uint32_t PieceTable::GetStyleAt(std::size_t offset, uint32_t fallback) const
+{
+    // New text takes on the style of the character before it, or the first character
+    // when inserting at the very start of the document.
+    if (mRoot == kNil) return fallback;
+    if (offset > 0) offset--;
+
+    uint32_t node = mRoot;
+    while (node != kNil)
+    {
+        const Node& n = mNodes[node];
+        const std::size_t leftLength = SubtreeLength(n.left);
+
+        if (offset < leftLength)
+            node = n.left;
+        else if (offset < leftLength + n.piece.length)
+            return n.piece.style;
+        else
+        {
+            offset -= leftLength + n.piece.length;
+            node = n.right;
+        }
+    }
+
+    return fallback;
+}
+
+bool PieceTable::FindPiece(std::size_t offset, Piece& piece, std::size_t& pieceStart) const
+{
+    uint32_t node = mRoot;
+    pieceStart = 0;
+
+    while (node != kNil)
+    {
+        const Node& n = mNodes[node];
+        const std::size_t leftLength = SubtreeLength(n.left);
+
+        if (offset < leftLength)
+            node = n.left;
+        else if (offset < leftLength + n.piece.length)
+        {
+            piece = n.piece;
+            pieceStart += leftLength;
+            return true;
+        }
+        else
+        {
+            offset -= leftLength + n.piece.length;
+            pieceStart += leftLength + n.piece.length;
+            node = n.right;
+        }
+    }
+
+    return false;
+}
+
+std::size_t PieceTable::GetOffsetAfterLineBreak(std::size_t lineBreak) const
+{
+    if (lineBreak == 0) return 0;
+    if (lineBreak > GetLineBreakCount()) return GetLength();
+
+    uint32_t node = mRoot;
+    std::size_t offset = 0;
+
+    while (node != kNil)
+    {
+        const Node& n = mNodes[node];
+        const std::size_t leftBreaks = SubtreeLineBreaks(n.left);
+
+        if (lineBreak <= leftBreaks)
+            node = n.left;
+        else if (lineBreak <= leftBreaks + n.pieceLineBreaks)
+        {
+            // Jump straight to the break inside the piece using the buffer's break positions.
+            const auto& breaks = GetLineBreaks(n.piece.buffer);
+            auto first = std::lower_bound(breaks.begin(), breaks.end(), n.piece.start);
+            auto position = *(first + (lineBreak - leftBreaks - 1));
+            return offset + SubtreeLength(n.left) + (position - n.piece.start) + 1;
+        }
+        else
+        {
+            lineBreak -= leftBreaks + n.pieceLineBreaks;
+            offset += SubtreeLength(n.left) + n.piece.length;
+            node = n.right;
+        }
+    }
+
+    return GetLength();
+}
+
+std::size_t PieceTable::GetLineBreaksBefore(std::size_t offset) const
+{
+    uint32_t node = mRoot;
+    std::size_t count = 0;
+
+    while (node != kNil)
+    {
+        const Node& n = mNodes[node];
+        const std::size_t leftLength = SubtreeLength(n.left);
+
+        if (offset <= leftLength)
+            node = n.left;
+        else if (offset < leftLength + n.piece.length)
+        {
+            const auto& breaks = GetLineBreaks(n.piece.buffer);
+            const std::size_t local = offset - leftLength;
+            return count + SubtreeLineBreaks(n.left)
+                + (std::lower_bound(breaks.begin(), breaks.end(), n.piece.start + local)
+                    - std::lower_bound(breaks.begin(), breaks.end(), n.piece.start));
+        }
+        else
+        {
+            offset -= leftLength + n.piece.length;
+            count += SubtreeLineBreaks(n.left) + n.pieceLineBreaks;
+            node = n.right;
+        }
+    }
+
+    return count;
+}
+
+Piece PieceTable::Insert(std::size_t offset, std::string_view text, uint32_t style)
+{
+    assert(offset <= GetLength());
+    if (text.empty()) return Piece{PieceBuffer::Add, style, mAdd.size(), 0};
+
+    const Piece added{PieceBuffer::Add, style, mAdd.size(), text.size()};
+    const std::size_t lineBreaksBefore = mAddLineBreaks.size();
+    AppendBuffer(mAdd, mAddLineBreaks, text);
+
+    // Typing appends to the add buffer right after the last inserted text, so most of the
+    // time the piece ending at the cursor can simply grow instead of splitting the tree.
+    if (ExtendPieceEndingAt(mRoot, offset, added, mAddLineBreaks.size() - lineBreaksBefore))
+        return added;
+
+    uint32_t left, right;
+    Split(mRoot, offset, left, right);
+    mRoot = Merge(Merge(left, AllocateNode(added)), right);
+    return added;
+}
+
+void PieceTable::InsertPieces(std::size_t offset, const Piece* pieces, std::size_t count)
+{
+    assert(offset <= GetLength());
+
+    uint32_t left, right;
+    Split(mRoot, offset, left, right);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        assert(pieces[i].start + pieces[i].length <= (pieces[i].buffer == PieceBuffer::Original ? mOriginal : mAdd).size());
+        if (pieces[i].length > 0)
+            left = Merge(left, AllocateNode(pieces[i]));
+    }
+    mRoot = Merge(left, right);
+}
+
+void PieceTable::Remove(std::size_t start, std::size_t end)
+{
+    end = std::min(end, GetLength());
+    if (start >= end) return;
+
+    uint32_t left, middle, right;
+    Split(mRoot, start, left, middle);
+    Split(middle, end - start, middle, right);
+    FreeSubtree(middle);
+    mRoot = Merge(left, right);
+}
+
+void PieceTable::Clear()
+{
+    mOriginal.clear();
+    mAdd.clear();
+    mOriginalLineBreaks.clear();
+    mAddLineBreaks.clear();
+    mNodes.clear();
+    mFreeNodes.clear();
+    mPieceCount = 0;
+    mRoot = kNil;
+}
+
+uint32_t PieceTable::AllocateNode(const Piece& piece)
+{
+    const std::size_t lineBreaks = CountLineBreaks(piece);
+    Node node{piece, NextPriority(), kNil, kNil, lineBreaks, piece.length, lineBreaks};
+    mPieceCount++;
+
+    if (!mFreeNodes.empty())
+    {
+        uint32_t index = mFreeNodes.back();
+        mFreeNodes.pop_back();
+        mNodes[index] = node;
+        return index;
+    }
+
+    mNodes.push_back(node);
+    return static_cast<uint32_t>(mNodes.size() - 1);
+}
+
+void PieceTable::FreeSubtree(uint32_t node)
+{
+    if (node == kNil) return;
+    FreeSubtree(mNodes[node].left);
+    FreeSubtree(mNodes[node].right);
+    mFreeNodes.push_back(node);
+    mPieceCount--;
+}
+
+void PieceTable::Update(uint32_t node)
+{
+    Node& n = mNodes[node];
+    n.subtreeLength = SubtreeLength(n.left) + n.piece.length + SubtreeLength(n.right);
+    n.subtreeLineBreaks = SubtreeLineBreaks(n.left) + n.pieceLineBreaks + SubtreeLineBreaks(n.right);
+}
+
+std::size_t PieceTable::CountLineBreaks(const Piece& piece) const
+{
+    const auto& breaks = GetLineBreaks(piece.buffer);
+    return std::lower_bound(breaks.begin(), breaks.end(), piece.start + piece.length)
+        - std::lower_bound(breaks.begin(), breaks.end(), piece.start);
+}
+
+void PieceTable::AppendBuffer(std::string& buffer, std::vector<std::size_t>& lineBreaks, std::string_view text)
+{
+    const std::size_t base = buffer.size();
+    buffer.append(text);
+
+    for (auto position = text.find('\n'); position != std::string_view::npos; position = text.find('\n', position + 1))
+        lineBreaks.push_back(base + position);
+}
+
+uint32_t PieceTable::Merge(uint32_t left, uint32_t right)
+{
+    if (left == kNil) return right;
+    if (right == kNil) return left;
+
+    if (mNodes[left].priority > mNodes[right].priority)
+    {
+        mNodes[left].right = Merge(mNodes[left].right, right);
+        Update(left);
+        return left;
+    }
+    else
+    {
+        mNodes[right].left = Merge(left, mNodes[right].left);
+        Update(right);
+        return right;
+    }
+}
+
+void PieceTable::Split(uint32_t node, std::size_t offset, uint32_t& left, uint32_t& right)
+{
+    if (node == kNil)
+    {
+        left = right = kNil;
+        return;
+    }
+
+    const std::size_t leftLength = SubtreeLength(mNodes[node].left);
+    const std::size_t pieceLength = mNodes[node].piece.length;
+
+    if (offset <= leftLength)
+    {
+        uint32_t child;
+        Split(mNodes[node].left, offset, left, child);
+        mNodes[node].left = child;
+        Update(node);
+        right = node;
+    }
+    else if (offset >= leftLength + pieceLength)
+    {
+        uint32_t child;
+        Split(mNodes[node].right, offset - leftLength - pieceLength, child, right);
+        mNodes[node].right = child;
+        Update(node);
+        left = node;
+    }
+    else
+    {
+        // The offset lands inside this piece, cut it in two. The tail becomes a new node
+        // that takes over the right subtree.
+        const std::size_t cut = offset - leftLength;
+        Piece tail = mNodes[node].piece;
+        tail.start += cut;
+        tail.length -= cut;
+
+        uint32_t tailNode = AllocateNode(tail);
+        uint32_t oldRight = mNodes[node].right;
+
+        mNodes[node].piece.length = cut;
+        mNodes[node].pieceLineBreaks -= mNodes[tailNode].pieceLineBreaks;
+        mNodes[node].right = kNil;
+        Update(node);
+
+        left = node;
+        right = Merge(tailNode, oldRight);
+    }
+}
+
+bool PieceTable::ExtendPieceEndingAt(uint32_t node, std::size_t offset, const Piece& added, std::size_t addedLineBreaks)
+{
+    if (node == kNil) return false;
+
+    Node& n = mNodes[node];
+    const std::size_t leftLength = SubtreeLength(n.left);
+    bool extended = false;
+
+    if (offset <= leftLength)
+    {
+        extended = ExtendPieceEndingAt(n.left, offset, added, addedLineBreaks);
+    }
+    else if (offset == leftLength + n.piece.length)
+    {
+        extended = n.piece.buffer == added.buffer
+            && n.piece.start + n.piece.length == added.start
+            && n.piece.style == added.style;
+
+        if (extended)
+        {
+            n.piece.length += added.length;
+            n.pieceLineBreaks += addedLineBreaks;
+        }
+    }
+    else if (offset > leftLength + n.piece.length)
+    {
+        extended = ExtendPieceEndingAt(n.right, offset - leftLength - n.piece.length, added, addedLineBreaks);
+    }
+
+    if (extended)
+        Update(node);
+
+    return extended;
+}
+
+uint32_t PieceTable::NextPriority()
+{
+    // xorshift32, treap priorities only need to be well spread not cryptographically random.
+    mSeed ^= mSeed << 13;
+    mSeed ^= mSeed >> 17;
+    mSeed ^= mSeed << 5;
+    return mSeed;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Which buffer a piece refers to. The original buffer is filled once while a document
+// is loaded and never modified afterwards, the add buffer only ever grows.
+enum class PieceBuffer : uint8_t {
+    Original,
+    Add
+};
+
+struct Piece {
+    PieceBuffer buffer;
+    uint32_t style;
+    std::size_t start;
+    std::size_t length;
+};
+
+// A piece table stored as an implicit treap ordered by document position, every node
+// caches the length and line break count of its subtree so lookups, inserts and removals
+// are O(log n) in the number of pieces. Offsets are byte offsets into the UTF-8 text.
+class PieceTable {
+public:
+    PieceTable();
+    ~PieceTable() = default;
+
+    /// LOADING ///
+    void AppendOriginal(std::string_view text, uint32_t style);
+    void LoadOriginal(std::string original, const std::vector<Piece>& pieces); // Pieces must refer to the original buffer.
+
+    /// META ///
+    std::size_t GetLength() const;
+    std::size_t GetLineBreakCount() const;
+    std::size_t GetPieceCount() const { return mPieceCount; }
+    std::string_view GetPieceText(const Piece& piece) const;
+    uint32_t GetStyleAt(std::size_t offset, uint32_t fallback) const;
+
+    // Finds the piece containing the byte at offset, pieceStart receives the document offset
+    // the piece begins at. Returns false when offset is past the end of the text.
+    bool FindPiece(std::size_t offset, Piece& piece, std::size_t& pieceStart) const;
+
+    // Document offset of the first byte after the n-th line break (n counted from 1).
+    std::size_t GetOffsetAfterLineBreak(std::size_t lineBreak) const;
+
+    // Number of line breaks strictly before offset.
+    std::size_t GetLineBreaksBefore(std::size_t offset) const;
+
+    template <typename Visitor>
+    void ForEachPiece(Visitor&& visitor) const { ForEachPiece(mRoot, visitor); }
+
+    // Visits the pieces covering [start, end), the first and last are cut to the range.
+    template <typename Visitor>
+    void ForEachPieceIn(std::size_t start, std::size_t end, Visitor&& visitor) const
+    {
+        Piece piece;
+        std::size_t pieceStart;
+        while (start < end && FindPiece(start, piece, pieceStart))
+        {
+            const std::size_t skip = start - pieceStart;
+            piece.start += skip;
+            piece.length = std::min(piece.length - skip, end - start);
+            visitor(piece);
+            start += piece.length;
+        }
+    }
+
+    /// EDITING ///
+    Piece Insert(std::size_t offset, std::string_view text, uint32_t style); // Returns the piece holding the new text.
+    void InsertPieces(std::size_t offset, const Piece* pieces, std::size_t count); // Pieces of text already in the buffers.
+    void Remove(std::size_t start, std::size_t end);
+    void Clear();
+
+private:
+    static constexpr uint32_t kNil = UINT32_MAX;
+
+    struct Node {
+        Piece piece;
+        uint32_t priority;
+        uint32_t left;
+        uint32_t right;
+        std::size_t pieceLineBreaks;
+        std::size_t subtreeLength;
+        std::size_t subtreeLineBreaks;
+    };
+
+    template <typename Visitor>
+    void ForEachPiece(uint32_t node, Visitor& visitor) const
+    {
+        if (node == kNil) return;
+        ForEachPiece(mNodes[node].left, visitor);
+        visitor(mNodes[node].piece);
+        ForEachPiece(mNodes[node].right, visitor);
+    }
+
+    uint32_t AllocateNode(const Piece& piece);
+    void FreeSubtree(uint32_t node);
+    void Update(uint32_t node);
+    std::size_t SubtreeLength(uint32_t node) const { return node == kNil ? 0 : mNodes[node].subtreeLength; }
+    std::size_t SubtreeLineBreaks(uint32_t node) const { return node == kNil ? 0 : mNodes[node].subtreeLineBreaks; }
+    const std::vector<std::size_t>& GetLineBreaks(PieceBuffer buffer) const { return buffer == PieceBuffer::Original ? mOriginalLineBreaks : mAddLineBreaks; }
+    std::size_t CountLineBreaks(const Piece& piece) const;
+    static void AppendBuffer(std::string& buffer, std::vector<std::size_t>& lineBreaks, std::string_view text);
+
+    uint32_t Merge(uint32_t left, uint32_t right);
+    void Split(uint32_t node, std::size_t offset, uint32_t& left, uint32_t& right);
+    bool ExtendPieceEndingAt(uint32_t node, std::size_t offset, const Piece& added, std::size_t addedLineBreaks);
+    uint32_t NextPriority();
+
+    std::string mOriginal;
+    std::string mAdd;
+    std::vector<std::size_t> mOriginalLineBreaks; // Sorted buffer positions of every '\n', the buffers
+    std::vector<std::size_t> mAddLineBreaks;      // only grow so these are only ever appended to.
+    std::vector<Node> mNodes;
+    std::vector<uint32_t> mFreeNodes;
+    std::size_t mPieceCount = 0;
+    uint32_t mRoot = kNil;
+    uint32_t mSeed = 0x9E3779B9u;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// Colors are packed the same way IM_COL32 packs them (0xAABBGGRR) so they can be handed to
+// ImGui unchanged. Hex codes are written the CSS way: #RGB, #RGBA, #RRGGBB or #RRGGBBAA.
+namespace RichTextColor {
+
+namespace detail {
+
+constexpr std::array<int8_t, 256> MakeHexDigitTable()
+{
+    std::array<int8_t, 256> table{};
+    for (auto& digit : table) digit = -1;
+    for (int c = '0'; c <= '9'; c++) table[c] = static_cast<int8_t>(c - '0');
+    for (int c = 'a'; c <= 'f'; c++) table[c] = static_cast<int8_t>(c - 'a' + 10);
+    for (int c = 'A'; c <= 'F'; c++) table[c] = static_cast<int8_t>(c - 'A' + 10);
+    return table;
+}
+
+inline constexpr std::array<int8_t, 256> kHexDigits = MakeHexDigitTable();
+
+} // namespace detail
+
+constexpr uint32_t Pack(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+    return (a << 24) | (b << 16) | (g << 8) | r;
+}
+
+constexpr std::optional<uint32_t> ParseHex(std::string_view code)
+{
+    const auto length = code.size();
+    if ((length != 4 && length != 5 && length != 7 && length != 9) || code[0] != '#')
+        return std::nullopt;
+
+    // Read every digit up front, any non hex character rejects the whole code.
+    uint32_t digits[8] = {};
+    for (std::size_t i = 1; i < length; i++)
+    {
+        auto digit = detail::kHexDigits[static_cast<unsigned char>(code[i])];
+        if (digit < 0) return std::nullopt;
+        digits[i - 1] = static_cast<uint32_t>(digit);
+    }
+
+    // Short forms repeat each digit, #F80 is #FF8800.
+    if (length <= 5)
+    {
+        auto alpha = length == 5 ? digits[3] * 0x11 : 0xFF;
+        return Pack(digits[0] * 0x11, digits[1] * 0x11, digits[2] * 0x11, alpha);
+    }
+
+    auto alpha = length == 9 ? (digits[6] << 4 | digits[7]) : 0xFF;
+    return Pack(digits[0] << 4 | digits[1], digits[2] << 4 | digits[3], digits[4] << 4 | digits[5], alpha);
+}
+
+// The text of a formatted hex code, kept inline so formatting never allocates.
+struct HexCode {
+    char text[10];
+    std::size_t length;
+
+    constexpr std::string_view View() const { return std::string_view(text, length); }
+};
+
+// Formats a packed color as #RRGGBB, or #RRGGBBAA when it is not fully opaque.
+constexpr HexCode FormatHex(uint32_t color)
+{
+    constexpr char kDigits[] = "0123456789ABCDEF";
+    const uint32_t channels[4] = {color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, color >> 24};
+    const std::size_t channelCount = channels[3] == 0xFF ? 3 : 4;
+
+    HexCode code{{'#'}, 1 + channelCount * 2};
+    for (std::size_t i = 0; i < channelCount; i++)
+    {
+        code.text[1 + i * 2] = kDigits[channels[i] >> 4];
+        code.text[2 + i * 2] = kDigits[channels[i] & 0xF];
+    }
+    return code;
+}
+
+static_assert(ParseHex("#F80") == Pack(0xFF, 0x88, 0x00, 0xFF));
+static_assert(ParseHex("#f80c") == Pack(0xFF, 0x88, 0x00, 0xCC));
+static_assert(ParseHex("#336699") == Pack(0x33, 0x66, 0x99, 0xFF));
+static_assert(ParseHex("#33669980") == Pack(0x33, 0x66, 0x99, 0x80));
+static_assert(!ParseHex("#12345"));
+static_assert(!ParseHex("#GGGGGG"));
+static_assert(!ParseHex("https://example.com"));
+static_assert(FormatHex(Pack(0x33, 0x66, 0x99, 0xFF)).View() == "#336699");
+static_assert(FormatHex(Pack(0x33, 0x66, 0x99, 0x80)).View() == "#33669980");
+static_assert(ParseHex(FormatHex(0x12345678).View()) == 0x12345678u);
+
+} // namespace RichTextColor
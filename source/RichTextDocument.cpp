@@ -1,148 +1,917 @@
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <ostream>
 #include <nlohmann/json_fwd.hpp>
-#include <regex>
 
 #include <nlohmann/json.hpp>
 
+#include "RichTextColor.h"
 #include "RichTextDocument.h"
 
+static constexpr std::size_t kMaxRecordedChanges = 1024;
+
 RichTextDocument::RichTextDocument()
+    : mChanges(kMaxRecordedChanges)
 {
 }
 
-RichTextDocument::RichTextDocument(nlohmann::json json)
+RichTextDocument::RichTextDocument(const nlohmann::json& json)
+    : RichTextDocument()
 {
-    ParseTextBlock(mBlocks, 0, json, nullptr);
+    ParseTextBlock(json, RichTextStyleTable::kDefaultStyle);
+}
+
+std::size_t RichTextDocument::GetDocumentCharacterLength()
+{
+    return mPieces.GetLength();
+}
+
+std::list<RichTextBlock> RichTextDocument::GetBlocks() const
+{
+    std::list<RichTextBlock> blocks;
+    uint32_t lastStyle = UINT32_MAX;
+
+    mPieces.ForEachPiece([&](const Piece& piece){
+        // Neighbouring pieces that share a style came from the same block before an edit split them.
+        if (piece.style != lastStyle)
+        {
+            RichTextBlock block;
+            static_cast<RichTextStyle&>(block) = mStyles.Get(piece.style);
+            blocks.push_back(std::move(block));
+            lastStyle = piece.style;
+        }
+
+        blocks.back().text.append(mPieces.GetPieceText(piece));
+    });
+
+    return blocks;
 }
 
 std::size_t RichTextDocument::GetLineCount() const
 {
-    if (mBlocks.empty()) return 0;
-    std::size_t count = 1;
-    for (const auto& block : mBlocks)
+    if (mPieces.GetLength() == 0) return 0;
+    return mPieces.GetLineBreakCount() + 1;
+}
+
+RichTextRunRange RichTextDocument::GetLine(std::size_t line) const
+{
+    if (line >= GetLineCount())
+        return RichTextRunRange(this, mPieces.GetLength(), mPieces.GetLength());
+
+    auto start = mPieces.GetOffsetAfterLineBreak(line);
+    auto end = line + 1 < GetLineCount() ? mPieces.GetOffsetAfterLineBreak(line + 1) - 1 : mPieces.GetLength();
+    return RichTextRunRange(this, start, end);
+}
+
+std::size_t RichTextDocument::GetLineStart(std::size_t line) const
+{
+    return mPieces.GetOffsetAfterLineBreak(line);
+}
+
+std::size_t RichTextDocument::GetLineAt(std::size_t characterLocation) const
+{
+    return mPieces.GetLineBreaksBefore(characterLocation);
+}
+
+RichTextRunRange RichTextDocument::GetRange(std::size_t characterStart, std::size_t characterEnd) const
+{
+    characterEnd = std::min(characterEnd, mPieces.GetLength());
+    return RichTextRunRange(this, std::min(characterStart, characterEnd), characterEnd);
+}
+
+RichTextRun RichTextDocument::GetRunAt(std::size_t characterLocation, std::size_t end) const
+{
+    Piece piece;
+    std::size_t pieceStart;
+    if (characterLocation >= end || !mPieces.FindPiece(characterLocation, piece, pieceStart))
+        return RichTextRun{{}, nullptr, RichTextStyleTable::kDefaultStyle, characterLocation};
+
+    auto text = mPieces.GetPieceText(piece).substr(characterLocation - pieceStart);
+    return RichTextRun{text.substr(0, end - characterLocation), &mStyles.Get(piece.style), piece.style, characterLocation};
+}
+
+RichTextRunIterator::RichTextRunIterator(const RichTextDocument* doc, std::size_t offset, std::size_t end)
+    : mDoc(doc), mOffset(offset), mEnd(end), mRun()
+{
+    Load();
+}
+
+RichTextRunIterator& RichTextRunIterator::operator++()
+{
+    mOffset += mRun.text.size();
+    Load();
+    return *this;
+}
+
+void RichTextRunIterator::Load()
+{
+    if (mOffset < mEnd)
+        mRun = mDoc->GetRunAt(mOffset, mEnd);
+
+    // Never get stuck if the range reaches past the end of the document.
+    if (mOffset < mEnd && mRun.text.empty())
+        mOffset = mEnd;
+}
+
+void RichTextDocument::Insert(std::size_t characterLocation, std::string_view string)
+{
+    if (string.empty()) return;
+
+    characterLocation = std::min(characterLocation, mPieces.GetLength());
+    auto line = GetLineAt(characterLocation);
+    auto lineBreaks = std::count(string.begin(), string.end(), '\n');
+    RecordChange(line, 0, lineBreaks);
+    mHistory.RecordInsert(characterLocation, mPieces.Insert(characterLocation, string, mPieces.GetStyleAt(characterLocation, 0)));
+
+    // Typing merges into one undo step per line.
+    if (lineBreaks > 0)
+        mHistory.BreakCoalescing();
+}
+
+void RichTextDocument::Insert(std::size_t characterLocation, const std::list<RichTextBlock>& blocks)
+{
+    characterLocation = std::min(characterLocation, mPieces.GetLength());
+
+    mHistory.BeginGroup();
+    for (const auto& block : blocks)
+    {
+        if (block.text.empty()) continue;
+        RecordChange(GetLineAt(characterLocation), 0, std::count(block.text.begin(), block.text.end(), '\n'));
+        mHistory.RecordInsert(characterLocation, mPieces.Insert(characterLocation, block.text, mStyles.Intern(block)));
+        characterLocation += block.text.size();
+    }
+    mHistory.EndGroup();
+}
+
+void RichTextDocument::Remove(std::size_t characterStart, std::size_t characterEnd)
+{
+    characterEnd = std::min(characterEnd, mPieces.GetLength());
+    if (characterStart >= characterEnd) return;
+
+    mHistory.RecordRemove(characterStart, characterEnd, mPieces);
+    RemovePieces(characterStart, characterEnd);
+}
+
+std::optional<std::size_t> RichTextDocument::Undo()
+{
+    auto record = mHistory.Undo();
+    if (!record) return std::nullopt;
+
+    std::size_t characterLocation = 0;
+    for (auto i = record->operationCount; i-- > 0;)
+    {
+        const auto& operation = mHistory.GetOperation(record->firstOperation + i);
+        if (operation.type == RichTextHistory::OperationType::Insert)
+        {
+            RemovePieces(operation.offset, operation.offset + operation.length);
+            characterLocation = operation.offset;
+        }
+        else
+        {
+            InsertPieces(operation.offset, mHistory.GetPieces(operation), operation.pieceCount);
+            characterLocation = operation.offset + operation.length;
+        }
+    }
+
+    return characterLocation;
+}
+
+std::optional<std::size_t> RichTextDocument::Redo()
+{
+    auto record = mHistory.Redo();
+    if (!record) return std::nullopt;
+
+    std::size_t characterLocation = 0;
+    for (std::size_t i = 0; i < record->operationCount; i++)
+    {
+        const auto& operation = mHistory.GetOperation(record->firstOperation + i);
+        if (operation.type == RichTextHistory::OperationType::Insert)
+        {
+            InsertPieces(operation.offset, mHistory.GetPieces(operation), operation.pieceCount);
+            characterLocation = operation.offset + operation.length;
+        }
+        else
+        {
+            RemovePieces(operation.offset, operation.offset + operation.length);
+            characterLocation = operation.offset;
+        }
+    }
+
+    return characterLocation;
+}
+
+void RichTextDocument::InsertPieces(std::size_t characterLocation, const Piece* pieces, std::size_t count)
+{
+    auto line = GetLineAt(characterLocation);
+    auto lineBreaks = mPieces.GetLineBreakCount();
+    mPieces.InsertPieces(characterLocation, pieces, count);
+    RecordChange(line, 0, mPieces.GetLineBreakCount() - lineBreaks);
+}
+
+void RichTextDocument::RemovePieces(std::size_t characterStart, std::size_t characterEnd)
+{
+    auto line = GetLineAt(characterStart);
+    RecordChange(line, GetLineAt(characterEnd) - line, 0);
+    mPieces.Remove(characterStart, characterEnd);
+}
+
+void RichTextDocument::RecordChange(std::size_t line, std::size_t removedLines, std::size_t insertedLines)
+{
+    mChanges.Record(RichTextChange{line, removedLines, insertedLines});
+}
+
+// Builds the document straight from SAX events. Blocks only remember the properties they
+// set themselves, styles are resolved once the whole input is read so that properties may
+// appear in any order around "children", just like with the DOM based parser.
+class RichTextJsonSax : public nlohmann::json_sax<nlohmann::json> {
+public:
+    explicit RichTextJsonSax(RichTextDocument& doc)
+        : mDoc(doc)
+    {
+    }
+
+    bool null() override { return Value(nullptr); }
+    bool boolean(bool value) override { return Value(value); }
+    bool number_integer(number_integer_t value) override { return Value(static_cast<int>(value)); }
+    bool number_unsigned(number_unsigned_t value) override { return Value(static_cast<int>(value)); }
+    bool number_float(number_float_t value, const string_t&) override { return Value(static_cast<float>(value)); }
+    bool string(string_t& value) override { return Value(std::move(value)); }
+    bool binary(binary_t&) override { return Value(nullptr); }
+
+    bool start_object(std::size_t) override
+    {
+        if (mSkipDepth > 0 || !OpensBlock())
+        {
+            mSkipDepth++;
+            return true;
+        }
+
+        auto parent = mStack.empty() ? kNoParent : mStack.back().block;
+        ImportedBlock block;
+        block.parent = parent;
+        mBlocks.push_back(std::move(block));
+        mStack.push_back(Frame{Frame::Block, static_cast<uint32_t>(mBlocks.size() - 1)});
+        mKey.clear();
+        return true;
+    }
+
+    bool end_object() override
+    {
+        if (mSkipDepth > 0)
+        {
+            mSkipDepth--;
+            return true;
+        }
+
+        mStack.pop_back();
+        mKey.clear();
+        return true;
+    }
+
+    bool start_array(std::size_t) override
+    {
+        if (mSkipDepth > 0 || mStack.empty() || mStack.back().type != Frame::Block || mKey != "children")
+        {
+            mSkipDepth++;
+            return true;
+        }
+
+        mStack.push_back(Frame{Frame::Children, mStack.back().block});
+        return true;
+    }
+
+    bool end_array() override
+    {
+        if (mSkipDepth > 0)
+        {
+            mSkipDepth--;
+            return true;
+        }
+
+        mStack.pop_back();
+        mKey.clear();
+        return true;
+    }
+
+    bool key(string_t& key) override
+    {
+        if (mSkipDepth == 0)
+            mKey = std::move(key);
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override
+    {
+        return false;
+    }
+
+    void Finish()
+    {
+        // Parents always come before their children, so one forward pass resolves every style.
+        // Blocks that set nothing reuse their parent's interned style without copying it.
+        std::vector<RichTextStyleId> styles(mBlocks.size());
+        std::vector<Piece> pieces;
+        pieces.reserve(mBlocks.size());
+
+        for (std::size_t i = 0; i < mBlocks.size(); i++)
+        {
+            auto& block = mBlocks[i];
+            auto parentStyle = block.parent == kNoParent ? RichTextStyleTable::kDefaultStyle : styles[block.parent];
+
+            if (block.flagsSet || block.fontSize || block.foregroundColor || block.backgroundColor || !block.additionalProperties.empty())
+            {
+                RichTextStyle style = mDoc.mStyles.Get(parentStyle);
+                style.propertyFlags = (style.propertyFlags & ~block.flagsSet) | block.flagValues;
+                if (block.fontSize) style.fontSize = *block.fontSize;
+                if (block.foregroundColor) style.foregroundColor = *block.foregroundColor;
+                if (block.backgroundColor) style.backgroundColor = *block.backgroundColor;
+                for (auto& property : block.additionalProperties)
+                    style.additionalProperties[property.first] = std::move(property.second);
+
+                styles[i] = mDoc.mStyles.Intern(style);
+                block.additionalProperties = {};
+            }
+            else styles[i] = parentStyle;
+
+            if (block.textLength == 0)
+                continue;
+
+            // Neighbouring blocks of the same style that are also neighbours in the buffer
+            // become a single piece.
+            if (!pieces.empty() && pieces.back().style == styles[i] && pieces.back().start + pieces.back().length == block.textStart)
+                pieces.back().length += block.textLength;
+            else
+                pieces.push_back(Piece{PieceBuffer::Original, styles[i], block.textStart, block.textLength});
+        }
+
+        mDoc.mPieces.LoadOriginal(std::move(mText), pieces);
+    }
+
+private:
+    static constexpr uint32_t kNoParent = UINT32_MAX;
+
+    struct ImportedBlock {
+        uint32_t parent = kNoParent;
+        RichTextPropertyFlags flagsSet = 0;
+        RichTextPropertyFlags flagValues = 0;
+        std::optional<float> fontSize;
+        std::optional<uint32_t> foregroundColor;
+        std::optional<uint32_t> backgroundColor;
+        std::vector<std::pair<std::string, RichTextPropertyValue>> additionalProperties;
+        std::size_t textStart = 0;
+        std::size_t textLength = 0;
+    };
+
+    struct Frame {
+        enum Type { Block, Children } type;
+        uint32_t block;
+    };
+
+    bool OpensBlock() const
+    {
+        if (mStack.empty()) return mBlocks.empty();
+        return mStack.back().type == Frame::Children || mKey == "children";
+    }
+
+    void SetFlag(ImportedBlock& block, RichTextPropertyFlags flag, bool enabled)
+    {
+        block.flagsSet |= flag;
+        if (enabled) block.flagValues |= flag;
+        else         block.flagValues &= ~flag;
+    }
+
+    template <typename T>
+    bool Value(T&& value)
+    {
+        // Scalars are only meaningful as properties of a block, array elements that are not
+        // objects are skipped like the DOM parser does.
+        if (mSkipDepth > 0 || mStack.empty() || mStack.back().type != Frame::Block)
+            return true;
+
+        auto& block = mBlocks[mStack.back().block];
+        using Value = std::decay_t<T>;
+
+        // Text other than a string is ignored rather than kept as a property, as by the DOM parser.
+        if constexpr (!std::is_same_v<Value, std::string>)
+        {
+            if (mKey == "text")
+            {
+                mKey.clear();
+                return true;
+            }
+        }
+
+        if constexpr (std::is_same_v<Value, std::string>)
+        {
+            if (mKey == "text")
+            {
+                block.textStart = mText.size();
+                block.textLength = value.size();
+                mText.append(value);
+            }
+            else if (mKey == "color" || mKey == "highlight")
+            {
+                auto color = RichTextDocument::ParseHexColorCode(value);
+                if (color)
+                    (mKey == "color" ? block.foregroundColor : block.backgroundColor) = color;
+            }
+            else if (mKey != "children")
+            {
+                auto color = RichTextDocument::ParseHexColorCode(value);
+                if (color.has_value())
+                    block.additionalProperties.emplace_back(mKey, color.value());
+                else
+                    block.additionalProperties.emplace_back(mKey, std::move(value));
+            }
+        }
+        else if constexpr (std::is_same_v<Value, bool>)
+        {
+            if (mKey == "bold") SetFlag(block, RichTextPropertyFlags_Bold, value);
+            else if (mKey == "italic") SetFlag(block, RichTextPropertyFlags_Italic, value);
+            else if (mKey == "underline") SetFlag(block, RichTextPropertyFlags_Underline, value);
+            else if (mKey != "children") block.additionalProperties.emplace_back(mKey, value);
+        }
+        else if constexpr (std::is_same_v<Value, float>)
+        {
+            if (mKey == "size") block.fontSize = value;
+            else if (mKey != "children") block.additionalProperties.emplace_back(mKey, value);
+        }
+        else if constexpr (std::is_same_v<Value, int>)
+        {
+            if (mKey != "children") block.additionalProperties.emplace_back(mKey, value);
+        }
+
+        mKey.clear();
+        return true;
+    }
+
+    RichTextDocument& mDoc;
+    std::vector<ImportedBlock> mBlocks;
+    std::vector<Frame> mStack;
+    std::string mText;
+    std::string mKey;
+    std::size_t mSkipDepth = 0;
+};
+
+void RichTextDocument::ResetContents()
+{
+    mPieces.Clear();
+    mStyles.Clear();
+    mHistory.Clear();
+
+    // Nothing derived from the old contents can be patched up, make everyone rebuild.
+    mChanges.Reset();
+}
+
+template <typename Input>
+bool RichTextDocument::ImportFromJSONInput(Input&& input)
+{
+    ResetContents();
+
+    RichTextJsonSax sax(*this);
+    if (!nlohmann::json::sax_parse(std::forward<Input>(input), &sax, nlohmann::json::input_format_t::json, false))
     {
-        count += std::count_if(block.text.begin(), block.text.end(), [](char c){
-            return c == '\n';
-        });
+        ResetContents();
+        return false;
     }
 
-    return count;
+    sax.Finish();
+    return true;
+}
+
+bool RichTextDocument::ImportFromJSON(std::string_view string)
+{
+    return ImportFromJSONInput(string);
 }
 
-std::list<RichTextBlock> RichTextDocument::GetLine(int line) const
+bool RichTextDocument::ImportFromJSON(std::istream& stream)
 {
-    if (line > GetLineCount()-1)
-        return {};
+    return ImportFromJSONInput(stream);
+}
+
+// Collects exported text into a fixed size buffer and hands it to the sink whenever the
+// buffer fills up, so exports use the same small amount of memory for any document size.
+class RichTextExportWriter {
+public:
+    explicit RichTextExportWriter(const RichTextSink& sink)
+        : mSink(sink)
+    {
+    }
+
+    ~RichTextExportWriter() { Flush(); }
+
+    void Write(std::string_view text)
+    {
+        if (text.size() > kCapacity - mLength)
+        {
+            Flush();
+            if (text.size() >= kCapacity)
+            {
+                mSink(text);
+                return;
+            }
+        }
 
-    std::list<RichTextBlock> out;
+        std::memcpy(mBuffer + mLength, text.data(), text.size());
+        mLength += text.size();
+    }
 
-    // Offset the iterator to the block containing the line.
-    auto firstBlock = mBlocks.begin();
-    auto currentLine = (std::size_t)0;
-    auto startOffset = (std::size_t)0; 
-    while(firstBlock != mBlocks.end() && currentLine < line) 
+    // Copies the text across in the longest stretches that need no escaping, escape maps the
+    // remaining characters to their replacement.
+    template <typename Escape>
+    void WriteEscaped(std::string_view text, const std::array<bool, 256>& needsEscape, Escape&& escape)
     {
-        // Search for the next line.
-        startOffset = 0;
-        while ((startOffset = firstBlock->text.find_first_of('\n', startOffset)) != std::string::npos
-                && currentLine < line)
+        std::size_t start = 0;
+        for (std::size_t i = 0; i < text.size(); i++)
         {
-            startOffset++;
-            currentLine++;
+            auto c = static_cast<unsigned char>(text[i]);
+            if (!needsEscape[c]) continue;
+
+            Write(text.substr(start, i - start));
+            escape(*this, c);
+            start = i + 1;
+        }
+        Write(text.substr(start));
+    }
+
+    void Flush()
+    {
+        if (mLength > 0)
+            mSink(std::string_view(mBuffer, mLength));
+        mLength = 0;
+    }
+
+private:
+    static constexpr std::size_t kCapacity = 16 * 1024;
+
+    const RichTextSink& mSink;
+    char mBuffer[kCapacity];
+    std::size_t mLength = 0;
+};
+
+static constexpr std::array<bool, 256> MakeEscapeTable(std::string_view characters, bool controlCharacters)
+{
+    std::array<bool, 256> table{};
+    for (int c = 0; c < 0x20; c++) table[c] = controlCharacters;
+    for (char c : characters) table[static_cast<unsigned char>(c)] = true;
+    return table;
+}
+
+static constexpr std::array<bool, 256> kJsonEscapes = MakeEscapeTable("\"\\", true);
+static constexpr std::array<bool, 256> kHtmlEscapes = MakeEscapeTable("&<>\"", false);
+
+static void WriteJsonText(RichTextExportWriter& writer, std::string_view text)
+{
+    writer.WriteEscaped(text, kJsonEscapes, [](RichTextExportWriter& writer, unsigned char c) {
+        switch (c)
+        {
+        case '"': writer.Write("\\\""); break;
+        case '\\': writer.Write("\\\\"); break;
+        case '\n': writer.Write("\\n"); break;
+        case '\r': writer.Write("\\r"); break;
+        case '\t': writer.Write("\\t"); break;
+        default:
+        {
+            constexpr char kDigits[] = "0123456789abcdef";
+            const char escaped[] = {'\\', 'u', '0', '0', kDigits[c >> 4], kDigits[c & 0xF]};
+            writer.Write(std::string_view(escaped, sizeof(escaped)));
             break;
         }
+        }
+    });
+}
 
-        if (currentLine < line)
-            firstBlock++;
+static void WriteHtmlText(RichTextExportWriter& writer, std::string_view text)
+{
+    writer.WriteEscaped(text, kHtmlEscapes, [](RichTextExportWriter& writer, unsigned char c) {
+        switch (c)
+        {
+        case '&': writer.Write("&amp;"); break;
+        case '<': writer.Write("&lt;"); break;
+        case '>': writer.Write("&gt;"); break;
+        case '"': writer.Write("&quot;"); break;
+        }
+    });
+}
+
+// Floats always keep a decimal point so they are read back as floats and not integers.
+static void AppendJsonFloat(std::string& out, float value)
+{
+    if (!std::isfinite(value))
+    {
+        out += "null";
+        return;
     }
 
-    // Find the final characters index in the line.
-    auto endOffset = std::string::npos;
-    auto foundFinal = false;
-    for (auto lastBlock = firstBlock; lastBlock != mBlocks.end() && !foundFinal; lastBlock++) 
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    out.append(buffer, length);
+    if (std::string_view(buffer, length).find_first_of(".e") == std::string_view::npos)
+        out += ".0";
+}
+
+static void AppendJsonString(std::string& out, std::string_view text)
+{
+    RichTextSink sink = [&out](std::string_view chunk) { out.append(chunk); };
+    RichTextExportWriter writer(sink);
+    writer.Write("\"");
+    WriteJsonText(writer, text);
+    writer.Write("\"");
+}
+
+// The properties a style sets on top of the default style, written once per style as the
+// tail of a JSON block: ,"bold":true,"size":24.0
+static std::string FormatJsonStyle(const RichTextStyle& style)
+{
+    const RichTextStyle defaults;
+    std::string out;
+
+    if (style.propertyFlags & RichTextPropertyFlags_Bold) out += ",\"bold\":true";
+    if (style.propertyFlags & RichTextPropertyFlags_Italic) out += ",\"italic\":true";
+    if (style.propertyFlags & RichTextPropertyFlags_Underline) out += ",\"underline\":true";
+    if (style.fontSize != defaults.fontSize)
+    {
+        out += ",\"size\":";
+        AppendJsonFloat(out, style.fontSize);
+    }
+    if (style.foregroundColor != defaults.foregroundColor)
     {
-        // Search for the next line.
-        if (lastBlock != firstBlock)
-            startOffset = 0;
+        out += ",\"color\":\"";
+        out += RichTextColor::FormatHex(style.foregroundColor).View();
+        out += "\"";
+    }
+    if (style.backgroundColor != defaults.backgroundColor)
+    {
+        out += ",\"highlight\":\"";
+        out += RichTextColor::FormatHex(style.backgroundColor).View();
+        out += "\"";
+    }
 
-        if ((endOffset = lastBlock->text.find_first_of('\n', startOffset)) != std::string::npos)
-            foundFinal = true;
+    // Sorted by key so the same document always exports the same bytes.
+    std::vector<const std::pair<const std::string, RichTextPropertyValue>*> properties;
+    for (const auto& property : style.additionalProperties)
+        properties.push_back(&property);
+    std::sort(properties.begin(), properties.end(), [](auto a, auto b) { return a->first < b->first; });
 
-        if (!startOffset && !endOffset) 
-            continue;
+    for (auto property : properties)
+    {
+        out += ",";
+        AppendJsonString(out, property->first);
+        out += ":";
 
-        // Add this block to the final line out.
-        auto newBlock = *lastBlock;
-        newBlock.text = lastBlock->text.substr(lastBlock == firstBlock ? startOffset : 0, endOffset);
-        out.emplace_back(newBlock);
+        std::visit([&out](const auto& value) {
+            using Value = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<Value, std::string>)
+                AppendJsonString(out, value);
+            else if constexpr (std::is_same_v<Value, float>)
+                AppendJsonFloat(out, value);
+            else if constexpr (std::is_same_v<Value, bool>)
+                out += value ? "true" : "false";
+            else if constexpr (std::is_same_v<Value, int>)
+                out += std::to_string(value);
+            else // Colors.
+            {
+                out += "\"";
+                out += RichTextColor::FormatHex(value).View();
+                out += "\"";
+            }
+        }, property->second);
     }
 
     return out;
 }
 
-std::optional<uint32_t> RichTextDocument::ParseHexColorCode(const std::string& code)
+// The opening tag for text in a style, empty when the style has nothing to say in CSS.
+static std::string FormatHtmlStyle(const RichTextStyle& style)
 {
-    static std::regex hexColorTest("^#(?:[0-9a-fA-F]{3,4}){1,2}$", std::regex_constants::optimize);
-    if (std::regex_search(code, hexColorTest))
-        return static_cast<uint32_t>(std::stoul(code.substr(1).data(), nullptr, 16));
-    else return std::nullopt;
+    const RichTextStyle defaults;
+    std::string css;
+
+    if (style.propertyFlags & RichTextPropertyFlags_Bold) css += "font-weight:bold;";
+    if (style.propertyFlags & RichTextPropertyFlags_Italic) css += "font-style:italic;";
+    if (style.propertyFlags & RichTextPropertyFlags_Underline) css += "text-decoration:underline;";
+    if (style.fontSize != defaults.fontSize && std::isfinite(style.fontSize))
+    {
+        char buffer[32];
+        css.append(buffer, std::snprintf(buffer, sizeof(buffer), "font-size:%gpx;", style.fontSize));
+    }
+    if (style.foregroundColor != defaults.foregroundColor)
+    {
+        css += "color:";
+        css += RichTextColor::FormatHex(style.foregroundColor).View();
+        css += ";";
+    }
+    if (style.backgroundColor != defaults.backgroundColor)
+    {
+        css += "background-color:";
+        css += RichTextColor::FormatHex(style.backgroundColor).View();
+        css += ";";
+    }
+
+    return css.empty() ? std::string() : "<span style=\"" + css + "\">";
 }
 
-void RichTextDocument::ParseTextBlock(std::list<RichTextBlock>& blocks, int currentLine, nlohmann::json formatObject, RichTextBlock* parent)
+// Style ids are dense, so the formatted form of each style is cached by id for one export.
+template <typename Format>
+class RichTextStyleFormatCache {
+public:
+    RichTextStyleFormatCache(const RichTextStyleTable& styles, Format format)
+        : mStyles(styles), mFormat(format), mFormatted(styles.GetStyleCount())
+    {
+    }
+
+    const std::string& Get(RichTextStyleId id)
+    {
+        auto& formatted = mFormatted[id];
+        if (!formatted)
+            formatted = mFormat(mStyles.Get(id));
+        return *formatted;
+    }
+
+private:
+    const RichTextStyleTable& mStyles;
+    Format mFormat;
+    std::vector<std::optional<std::string>> mFormatted;
+};
+
+void RichTextDocument::ExportToJSON(const RichTextSink& sink) const
 {
-    RichTextBlock block;
-    if (parent)
-        block = *parent;
+    RichTextExportWriter writer(sink);
+    RichTextStyleFormatCache styles(mStyles, FormatJsonStyle);
+    std::optional<RichTextStyleId> openStyle;
 
-    block.text = formatObject.value("text", ""); // Text is the only property that is never inherited by parents.
+    writer.Write("{\"children\":[");
+    mPieces.ForEachPiece([&](const Piece& piece) {
+        // Neighbouring pieces of the same style continue the open block.
+        if (openStyle != piece.style)
+        {
+            if (openStyle)
+            {
+                writer.Write("\"");
+                writer.Write(styles.Get(*openStyle));
+                writer.Write("},\n");
+            }
+            else writer.Write("\n");
 
-    // Parse through all text properties.
-    for (auto property : formatObject.items()) 
+            writer.Write("{\"text\":\"");
+            openStyle = piece.style;
+        }
+
+        WriteJsonText(writer, mPieces.GetPieceText(piece));
+    });
+
+    if (openStyle)
     {
-        auto& key = property.key();
-        auto& value = property.value();
+        writer.Write("\"");
+        writer.Write(styles.Get(*openStyle));
+        writer.Write("}\n");
+    }
+    writer.Write("]}\n");
+}
 
-        // Parse through the default values that rich text always have.
-        if (key == "bold" && value.is_boolean()) 
-        { 
-            if (value)  block.propertyFlags |= RichTextPropertyFlags_Bold;
-            else        block.propertyFlags &= ~RichTextPropertyFlags_Bold;
+void RichTextDocument::ExportToJSON(std::ostream& stream) const
+{
+    ExportToJSON([&stream](std::string_view chunk) { stream.write(chunk.data(), chunk.size()); });
+}
+
+std::string RichTextDocument::ExportToJSON() const
+{
+    std::string out;
+    ExportToJSON([&out](std::string_view chunk) { out.append(chunk); });
+    return out;
+}
+
+void RichTextDocument::ExportToHTML(const RichTextSink& sink) const
+{
+    RichTextExportWriter writer(sink);
+    RichTextStyleFormatCache styles(mStyles, FormatHtmlStyle);
+    const std::string* openSpan = nullptr; // The open span's tag, empty when text is unstyled.
+    std::optional<RichTextStyleId> openStyle;
+    bool lineHasText = false;
+
+    auto closeSpan = [&]() {
+        if (openSpan && !openSpan->empty())
+            writer.Write("</span>");
+        openSpan = nullptr;
+        openStyle.reset();
+    };
+
+    auto endLine = [&]() {
+        closeSpan();
+        writer.Write(lineHasText ? "</p>\n" : "<p><br></p>\n");
+        lineHasText = false;
+    };
+
+    auto writeText = [&](std::string_view text, RichTextStyleId style) {
+        if (text.empty()) return;
+
+        if (!lineHasText)
+        {
+            writer.Write("<p>");
+            lineHasText = true;
         }
-        else if (key == "italic" && value.is_boolean())
+
+        // Neighbouring pieces of the same style share one span.
+        if (openStyle != style)
         {
-            if (value)  block.propertyFlags |= RichTextPropertyFlags_Italic;
-            else        block.propertyFlags &= ~RichTextPropertyFlags_Italic;
+            closeSpan();
+            openSpan = &styles.Get(style);
+            openStyle = style;
+            writer.Write(*openSpan);
         }
-        else if (key == "underline" && value.is_boolean()) 
+
+        WriteHtmlText(writer, text);
+    };
+
+    mPieces.ForEachPiece([&](const Piece& piece) {
+        auto text = mPieces.GetPieceText(piece);
+        for (auto position = text.find('\n'); position != std::string_view::npos; position = text.find('\n'))
         {
-            if (value)  block.propertyFlags |= RichTextPropertyFlags_Underline;
-            else        block.propertyFlags &= ~RichTextPropertyFlags_Underline;
+            writeText(text.substr(0, position), piece.style);
+            endLine();
+            text.remove_prefix(position + 1);
         }
+        writeText(text, piece.style);
+    });
+
+    endLine();
+}
+
+void RichTextDocument::ExportToHTML(std::ostream& stream) const
+{
+    ExportToHTML([&stream](std::string_view chunk) { stream.write(chunk.data(), chunk.size()); });
+}
+
+std::string RichTextDocument::ExportToHTML() const
+{
+    std::string out;
+    ExportToHTML([&out](std::string_view chunk) { out.append(chunk); });
+    return out;
+}
+
+std::optional<uint32_t> RichTextDocument::ParseHexColorCode(std::string_view code)
+{
+    return RichTextColor::ParseHex(code);
+}
+
+void RichTextDocument::ParseTextBlock(const nlohmann::json& formatObject, RichTextStyleId parentStyle)
+{
+    // Children share their parent's interned style until they set a property of their own,
+    // only then is the style copied and interned again.
+    std::optional<RichTextStyle> style;
+    auto editStyle = [&]() -> RichTextStyle& {
+        if (!style)
+            style = mStyles.Get(parentStyle);
+        return *style;
+    };
+
+    auto setFlag = [&](RichTextPropertyFlags flag, bool enabled) {
+        if (enabled) editStyle().propertyFlags |= flag;
+        else         editStyle().propertyFlags &= ~flag;
+    };
+
+    // Parse through all text properties.
+    for (const auto& property : formatObject.items()) 
+    {
+        const auto& key = property.key();
+        const auto& value = property.value();
+
+        // Parse through the default values that rich text always have.
+        if (key == "bold" && value.is_boolean()) 
+            setFlag(RichTextPropertyFlags_Bold, value.get<bool>());
+        else if (key == "italic" && value.is_boolean())
+            setFlag(RichTextPropertyFlags_Italic, value.get<bool>());
+        else if (key == "underline" && value.is_boolean()) 
+            setFlag(RichTextPropertyFlags_Underline, value.get<bool>());
         else if (key == "color" && value.is_string())
         {
-            auto color = ParseHexColorCode(value);
+            auto color = ParseHexColorCode(value.get_ref<const std::string&>());
             if (color)
-                block.foregroundColor = color.value();
+                editStyle().foregroundColor = color.value();
         }
         else if (key == "highlight" && value.is_string())
         {
-            auto color = ParseHexColorCode(value);
+            auto color = ParseHexColorCode(value.get_ref<const std::string&>());
             if (color)
-                block.backgroundColor = color.value();
+                editStyle().backgroundColor = color.value();
         }
         else if (key == "size" && value.is_number_float())
         {
-            block.fontSize = value.get<float>();
+            editStyle().fontSize = value.get<float>();
         }
-        else if (key != "children") 
+        else if (key != "children" && key != "text") 
         {
             // Parse any additional json values that could be more user-defined properties.
             RichTextPropertyValue additional;
 
             if (value.is_string()) {
                 // Test strings for hex color codes.
-                auto str = value.get<std::string>();
+                const auto& str = value.get_ref<const std::string&>();
                 auto color = ParseHexColorCode(str);
 
                 if (color.has_value())
@@ -159,31 +928,34 @@ void RichTextDocument::ParseTextBlock(std::list<RichTextBlock>& blocks, int curr
             else 
                 continue; // Skip properties that are invalid.
 
-            block.additionalProperties[key] = additional;
+            editStyle().additionalProperties[key] = std::move(additional);
         }
     }
 
-    blocks.push_back(block);
+    auto styleId = style ? mStyles.Intern(*style) : parentStyle;
+
+    // Text is the only property that is never inherited by children.
+    auto text = formatObject.find("text");
+    if (text != formatObject.end() && text->is_string())
+        mPieces.AppendOriginal(text->get_ref<const std::string&>(), styleId);
 
     // Parse all the children last that way we have all the properties are in the block.
-    auto childObject = formatObject.find("children");
-    if (childObject != formatObject.end())
+    auto children = formatObject.find("children");
+    if (children != formatObject.end())
     {
-        auto children = childObject.value(); 
-
         // Parse through child objects, could be a singluar object or an array of child objects.
-        if (children.is_object())
+        if (children->is_object())
         {
-            ParseTextBlock(blocks, currentLine, children, &block);
+            ParseTextBlock(*children, styleId);
         }
-        else if (children.is_array())
+        else if (children->is_array())
         {
             // Ensure all the child values are objects and recursively process them.
-            for (auto object : children) {
+            for (const auto& object : *children) {
                 if (object.is_object())
-                    ParseTextBlock(blocks, currentLine, object, &block);
+                    ParseTextBlock(object, styleId);
                 else continue; // Text child objects must be objects. 
             }
         }
     }
-}
\ No newline at end of file
+}
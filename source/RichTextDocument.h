@@ -2,73 +2,168 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <iosfwd>
 #include <list>
 #include <optional>
 #include <string>
 #include <string_view>
-#include <unordered_map>
-#include <variant>
+#include <vector>
 
 #include <nlohmann/json_fwd.hpp>
 
-typedef int RichTextPropertyFlags;
-enum RichTextPropertyFlagBits {
-    RichTextPropertyFlags_Bold = 0x00000001,
-    RichTextPropertyFlags_Italic = 0x00000002,
-    RichTextPropertyFlags_Underline = 0x00000004,
-    RichTextPropertyFlags_Centered = 0x00000008,
-    RichTextPropertyFlags_RightAligned = 0x00000010,
-    RichTextPropertyFlag_IsLine = 0x00000020
-};
-
-using RichTextPropertyValue = std::variant<std::string, float, int, bool, uint32_t /* colors */>;
+#include "ChangeJournal.h"
+#include "PieceTable.h"
+#include "RichTextHistory.h"
+#include "RichTextStyle.h"
 
-class RichTextBlock {
+class RichTextBlock : public RichTextStyle {
 public:
     RichTextBlock()
-        : text()
-        , propertyFlags(0)
-        , fontSize(18.0f)
-        , foregroundColor(0xFF000000)
-        , backgroundColor(0x0)
-        , additionalProperties()
+        : RichTextStyle()
+        , text()
     {
     }
 
     std::string text;
-    RichTextPropertyFlags propertyFlags;
-    float fontSize;
-    uint32_t foregroundColor;
-    uint32_t backgroundColor;
-    std::unordered_map<std::string, RichTextPropertyValue> additionalProperties;
+};
+
+class RichTextDocument;
+
+// Receives exported text in chunks as it is produced.
+typedef std::function<void(std::string_view)> RichTextSink;
+
+// Describes one edit in terms of lines: lines [line, line + removedLines] were replaced by
+// lines [line, line + insertedLines]. Caches keyed on lines use these to stay in sync.
+struct RichTextChange {
+    std::size_t line;
+    std::size_t removedLines;
+    std::size_t insertedLines;
+};
+
+// A run is a stretch of text that shares one style. It points straight into the document's
+// buffers, so it stays valid only until the document is next edited.
+struct RichTextRun {
+    std::string_view text;
+    const RichTextStyle* style;
+    RichTextStyleId styleId;
+    std::size_t offset;
+};
+
+class RichTextRunIterator {
+public:
+    RichTextRunIterator(const RichTextDocument* doc, std::size_t offset, std::size_t end);
+
+    const RichTextRun& operator*() const { return mRun; }
+    const RichTextRun* operator->() const { return &mRun; }
+    RichTextRunIterator& operator++();
+    bool operator==(const RichTextRunIterator& other) const { return mOffset == other.mOffset; }
+    bool operator!=(const RichTextRunIterator& other) const { return mOffset != other.mOffset; }
+
+private:
+    void Load();
+
+    const RichTextDocument* mDoc;
+    std::size_t mOffset;
+    std::size_t mEnd;
+    RichTextRun mRun;
+};
+
+// A view over the runs between two document offsets, nothing is copied.
+class RichTextRunRange {
+public:
+    RichTextRunRange(const RichTextDocument* doc, std::size_t start, std::size_t end)
+        : mDoc(doc), mStart(start), mEnd(end)
+    {
+    }
+
+    RichTextRunIterator begin() const { return RichTextRunIterator(mDoc, mStart, mEnd); }
+    RichTextRunIterator end() const { return RichTextRunIterator(mDoc, mEnd, mEnd); }
+    std::size_t GetStart() const { return mStart; }
+    std::size_t GetEnd() const { return mEnd; }
+    std::size_t GetLength() const { return mEnd - mStart; }
+    bool IsEmpty() const { return mStart == mEnd; }
+
+private:
+    const RichTextDocument* mDoc;
+    std::size_t mStart;
+    std::size_t mEnd;
 };
 
 class RichTextDocument {
 public:
     RichTextDocument();
-    RichTextDocument(nlohmann::json jsonDocument);
+    RichTextDocument(const nlohmann::json& jsonDocument);
     ~RichTextDocument() = default;
 
     /// META ///
     std::size_t GetDocumentCharacterLength();
-    std::string ExportToJSON();
-    std::string ExportToHTML();
-    auto& GetBlocks() const { return mBlocks; }
+    std::list<RichTextBlock> GetBlocks() const;
+    const RichTextStyleTable& GetStyles() const { return mStyles; }
+    RichTextRunRange GetRuns() const { return RichTextRunRange(this, 0, mPieces.GetLength()); }
     std::size_t GetLineCount() const;
-    std::list<RichTextBlock> GetLine(int line) const;
+    RichTextRunRange GetLine(std::size_t line) const; // Excludes the trailing '\n'.
+    std::size_t GetLineStart(std::size_t line) const;
+    std::size_t GetLineAt(std::size_t characterLocation) const;
+    RichTextRunRange GetRange(std::size_t characterStart, std::size_t characterEnd) const;
+
+    // Line changes since a version, see ChangeJournal.
+    uint64_t GetVersion() const { return mChanges.GetVersion(); }
+    bool GetChangesSince(uint64_t version, std::vector<RichTextChange>& changes) const { return mChanges.GetChangesSince(version, changes); }
+
+    /// IMPORT ///
+    // Streams the JSON rich text format straight into the document without building a
+    // JSON DOM first. Replaces the current contents, returns false on malformed input.
+    bool ImportFromJSON(std::string_view string);
+    bool ImportFromJSON(std::istream& stream);
+
+    /// EXPORT ///
+    // Exporters stream through the sink in bounded chunks, runs that share a style are written
+    // as one block and the whole output is never held in memory unless asked for as a string.
+    void ExportToJSON(const RichTextSink& sink) const;
+    void ExportToJSON(std::ostream& stream) const;
+    std::string ExportToJSON() const;
+    void ExportToHTML(const RichTextSink& sink) const; // An HTML fragment, one <p> per line.
+    void ExportToHTML(std::ostream& stream) const;
+    std::string ExportToHTML() const;
 
     /// EDITING ///
     void Insert(std::size_t characterLocation, std::string_view string);
     void Insert(std::size_t characterLocation, const std::list<RichTextBlock>& blocks);
     void Remove(std::size_t characterStart, std::size_t characterEnd);
+
+    /// HISTORY ///
+    // Both return where the step took place so the cursor can follow, or nothing when
+    // there is no step to take. Edits between BeginUndoGroup and EndUndoGroup are one step.
+    std::optional<std::size_t> Undo();
+    std::optional<std::size_t> Redo();
+    bool CanUndo() const { return mHistory.CanUndo(); }
+    bool CanRedo() const { return mHistory.CanRedo(); }
+    void BeginUndoGroup() { mHistory.BeginGroup(); }
+    void EndUndoGroup() { mHistory.EndGroup(); }
+    void BreakUndoCoalescing() { mHistory.BreakCoalescing(); } // E.g. when the cursor moves.
+    RichTextHistory& GetHistory() { return mHistory; }
     
 private:
-    void ParseTextBlock(std::list<RichTextBlock>& blocks, int currentLine, nlohmann::json formatObject, RichTextBlock* parent);
+    friend class RichTextRunIterator;
+    friend class RichTextJsonSax;
+
+    RichTextRun GetRunAt(std::size_t characterLocation, std::size_t end) const;
+    void ParseTextBlock(const nlohmann::json& formatObject, RichTextStyleId parentStyle);
+    void RecordChange(std::size_t line, std::size_t removedLines, std::size_t insertedLines);
+    void InsertPieces(std::size_t characterLocation, const Piece* pieces, std::size_t count);
+    void RemovePieces(std::size_t characterStart, std::size_t characterEnd);
     size_t UTF8CharLength(char c);
-    std::optional<uint32_t> ParseHexColorCode(const std::string& code);
+    static std::optional<uint32_t> ParseHexColorCode(std::string_view code);
 
     void ImportFromHTML(std::string_view string);
-    void ImportFromJSON(std::string_view string);
+    template <typename Input> bool ImportFromJSONInput(Input&& input);
+    void ResetContents();
+
+    // Text lives in the piece table, each piece refers to an interned style by id.
+    PieceTable mPieces;
+    RichTextStyleTable mStyles;
+    RichTextHistory mHistory;
 
-    std::list<RichTextBlock> mBlocks;
+    ChangeJournal<RichTextChange> mChanges;
 };
\ No newline at end of file
@@ -9,10 +9,12 @@
 #include <cstdlib>
 #include <string>
 
+#include "AllocationCounter.h"
 #include "RichTextEditor.h"
 
 RichTextEditor::RichTextEditor(ImFont* normalFont, ImFont* boldFont, ImFont* italicFont, ImFont* italicBoldFont)
-    : mNormalFont(normalFont), mBoldFont(boldFont), mItalicFont(italicFont), mItalicBoldFont(italicBoldFont)
+    : mCursorLine(0), mCursorColumn(0), mCursorColor(0xFF1b1b1b), mDoc(nullptr)
+    , mNormalFont(normalFont), mBoldFont(boldFont), mItalicFont(italicFont), mItalicBoldFont(italicBoldFont)
 {
 }
 
@@ -23,6 +25,23 @@ RichTextEditor::~RichTextEditor()
 void RichTextEditor::SetDocument(RichTextDocument& doc)
 {
     mDoc = &doc;
+    mLayout.clear();
+    mParagraphOffsets.clear();
+    mResolvedFonts.clear();
+    mLayoutVersion = doc.GetVersion();
+}
+
+void RichTextEditor::SetFonts(ImFont* normalFont, ImFont* boldFont, ImFont* italicFont, ImFont* italicBoldFont)
+{
+    mNormalFont = normalFont;
+    mBoldFont = boldFont;
+    mItalicFont = italicFont;
+    mItalicBoldFont = italicBoldFont;
+
+    // Every measurement was made with the old fonts.
+    mLayout.clear();
+    mParagraphOffsets.clear();
+    mResolvedFonts.clear();
 }
 
 size_t RichTextEditor::UTF8CharLength(char c)
@@ -80,21 +99,51 @@ void RichTextEditor::HandleKeyboardInput() {
 	}
 }
 
-ImFont* RichTextEditor::GetBlockFont(RichTextPropertyFlags flags)
+void RichTextEditor::SetGlyphCache(FontGlyphCache* glyphCache)
+{
+    mGlyphCache = glyphCache;
+    mLayoutGlyphGeneration = glyphCache ? glyphCache->GetGeneration() : 0;
+    mLayout.clear();
+    mParagraphOffsets.clear();
+}
+
+void RichTextEditor::SetPaginator(ScriptPaginator* paginator)
 {
-    if (flags & RichTextPropertyFlags_Bold)
-        return mBoldFont;
+    mPaginator = paginator;
+}
+
+ImFont* RichTextEditor::GetBlockFont(RichTextPropertyFlags flags) const
+{
+    ImFont* font = nullptr;
+    if ((flags & RichTextPropertyFlags_Bold) && (flags & RichTextPropertyFlags_Italic))
+        font = mItalicBoldFont;
+    else if (flags & RichTextPropertyFlags_Bold)
+        font = mBoldFont;
     else if (flags & RichTextPropertyFlags_Italic)
-        return mItalicFont;
-    else if (flags & RichTextPropertyFlags_Bold && flags & RichTextPropertyFlags_Italic)
-        return mItalicBoldFont;
-    else
-        return mNormalFont;
+        font = mItalicFont;
+
+    // Variants that were not provided fall back to the normal font.
+    return font ? font : mNormalFont;
 }
 
-void RichTextEditor::ComputeLineAttributes(std::list<RichTextBlock>& line, float& maxFontSize, float& maxBaseline)
+void RichTextEditor::UpdateFontTable()
 {
+    if (mResolvedFontsDpiScaling != mDpiScaling)
+    {
+        mResolvedFonts.clear();
+        mResolvedFontsDpiScaling = mDpiScaling;
+    }
 
+    // Styles get interned as the document is edited, resolve only the ones that are new.
+    const auto& styles = mDoc->GetStyles();
+    for (auto id = mResolvedFonts.size(); id < styles.GetStyleCount(); id++)
+    {
+        const auto& style = styles.Get(static_cast<RichTextStyleId>(id));
+        ImFont* font = GetBlockFont(style.propertyFlags);
+        auto fontSize = style.fontSize * mDpiScaling;
+        auto descent = std::abs(ImLinearRemapClamp(0, font->FontSize, 0, fontSize, std::abs(font->Descent)));
+        mResolvedFonts.push_back(ResolvedFont{font, fontSize, fontSize / font->FontSize, descent});
+    }
 }
 
 void RichTextEditor::SetDPIScaling(float dpiScaling)
@@ -102,168 +151,271 @@ void RichTextEditor::SetDPIScaling(float dpiScaling)
     mDpiScaling = dpiScaling;
 }
 
-void RichTextEditor::Render() 
+void RichTextEditor::UpdateLayout(float wrapWidth)
 {
-    HandleKeyboardInput();
+    auto dirtyFrom = mLayout.size();
 
-    auto drawList = ImGui::GetWindowDrawList();
+    // Splice the paragraph cache to follow the edits made since the last frame, only the
+    // paragraphs an edit touched lose their layout.
+    auto inSync = mDoc->GetChangesSince(mLayoutVersion, mLayoutChanges);
 
-    // Draw the background for the editor.
-    auto drawCursorStart = ImGui::GetCursorScreenPos();
-    auto drawCursor = drawCursorStart;
-    auto contentRegion = ImGui::GetContentRegionAvail();
-    auto backgroundRect = ImRect(drawCursor.x, drawCursor.y, drawCursor.x + contentRegion.x, drawCursor.y + contentRegion.y);
-    auto wrapWidth = contentRegion.x;
-    auto lineStartY = drawCursorStart.y;
+    // Glyphs that were missing when text was measured have been added since, measure again.
+    if (mGlyphCache && mGlyphCache->GetGeneration() != mLayoutGlyphGeneration)
+    {
+        mLayoutGlyphGeneration = mGlyphCache->GetGeneration();
+        inSync = false;
+    }
 
-    drawList->AddRectFilled(backgroundRect.Min, backgroundRect.Max, 0xFFe0e0e0);
-    drawList->PushClipRect(backgroundRect.Min, backgroundRect.Max, false);
+    // When the document was replaced its style ids may now mean different styles.
+    if (!inSync)
+        mResolvedFonts.clear();
+    UpdateFontTable();
+    if (inSync)
+    {
+        for (const auto& change : mLayoutChanges)
+        {
+            auto first = std::min(change.line, mLayout.size());
+            auto last = std::min(change.line + change.removedLines + 1, mLayout.size());
+            mLayout.erase(mLayout.begin() + first, mLayout.begin() + last);
+            mLayout.insert(mLayout.begin() + first, change.insertedLines + 1, ParagraphLayout());
+            dirtyFrom = std::min(dirtyFrom, first);
+        }
+    }
+
+    if (!inSync || mLayout.size() != mDoc->GetLineCount())
+    {
+        mLayout.clear();
+        mLayout.resize(mDoc->GetLineCount());
+        dirtyFrom = 0;
+    }
+
+    if (wrapWidth != mLayoutWrapWidth || mDpiScaling != mLayoutDpiScaling || mParagraphOffsets.size() != mLayout.size() + 1)
+        dirtyFrom = 0;
 
-    if (!mDoc) return;
+    mLayoutVersion = mDoc->GetVersion();
+    mLayoutWrapWidth = wrapWidth;
+    mLayoutDpiScaling = mDpiScaling;
 
-    // Loop through all document blocks and render each line of text in a block.
-    auto blocks = mDoc->GetBlocks();
-    for (auto it = blocks.begin(); it != blocks.end(); ++it)
+    // Nothing changed, the cache and the prefix sums are still good.
+    if (dirtyFrom >= mLayout.size() && mParagraphOffsets.size() == mLayout.size() + 1)
+        return;
+
+    for (std::size_t paragraph = dirtyFrom; paragraph < mLayout.size(); paragraph++)
     {
-        const auto& block = (*it);
-        // Draw the text blocks.
-        int currentColumn = 0;
-        
-        //auto cursorScreenCoordinates = cursorScreenPos;
-        //auto cursorFontHeight = line.size() > 0 ? line.front().fontSize : mDefaultFontSize;
-        //auto cursorBaselineDifference = line.size() > 0 ? line.front().fontSize : mDefaultFontSize;
-
-        const char* textStartFirst = block.text.data();
-        const char* textStart = block.text.data();
-        const char* textEnd = textStart + strlen(textStart);
-
-        auto maxFontSize = 0.0f;
-        auto maxBaseline = 0.0f;
-        auto getLineData = [&](){
-            // Find the maximum font size used in this line.
-            maxFontSize = maxBaseline = 0.0f;
-            
-            for (auto lineIterator = it; lineIterator != blocks.end(); ++lineIterator) 
-            {
-                auto endLocation = block.text.find_first_of('\n', textStart - textStartFirst);
-        
-                maxFontSize = std::max(maxFontSize, (block.fontSize * mDpiScaling));
-                ImFont* font = GetBlockFont(block.propertyFlags);
-                auto mappedDescent = ImLinearRemapClamp(0, font->FontSize, 0, block.fontSize * mDpiScaling, std::abs(font->Descent));
-                maxBaseline = std::max(maxBaseline, std::abs(mappedDescent));
-
-                if (endLocation != std::string::npos)
-                    break;
-            }
-        };
+        auto& layout = mLayout[paragraph];
+        if (layout.valid && layout.dpiScaling == mDpiScaling && layout.wrapWidth == wrapWidth)
+            continue;
 
-        do
+        // A paragraph that fit on one line still fits if the editor only got wider or did
+        // not shrink below its width, there is nothing to wrap differently.
+        if (layout.valid && layout.dpiScaling == mDpiScaling && layout.lines.size() == 1 && layout.naturalWidth < wrapWidth)
         {
-            // Find the maximum font size used in this line.
-            getLineData();
+            layout.wrapWidth = wrapWidth;
+            continue;
+        }
 
-            const auto& additionalProperties = block.additionalProperties;
+        LayoutParagraph(paragraph, layout, wrapWidth);
+    }
 
-            // Determine the font that we're going to use.
-            ImFont* font = GetBlockFont(block.propertyFlags);
+    // Cumulative paragraph heights, the offsets before the first dirty paragraph still hold.
+    mParagraphOffsets.resize(mLayout.size() + 1);
+    mParagraphOffsets[0] = 0.0f;
+    for (std::size_t paragraph = dirtyFrom; paragraph < mLayout.size(); paragraph++)
+        mParagraphOffsets[paragraph + 1] = mParagraphOffsets[paragraph] + mLayout[paragraph].height;
+}
+
+void RichTextEditor::LayoutParagraph(std::size_t paragraph, ParagraphLayout& layout, float wrapWidth)
+{
+    layout.valid = true;
+    layout.wrapWidth = wrapWidth;
+    layout.dpiScaling = mDpiScaling;
+    layout.lines.clear();
+    layout.fragments.clear();
+    layout.lines.push_back(LayoutLine{0, 0, 0.0f, 0.0f});
+
+    auto line = mDoc->GetLine(paragraph);
+    auto lineStart = line.GetStart();
+    auto x = 0.0f;
+
+    auto newLine = [&](){
+        layout.lines.push_back(LayoutLine{static_cast<uint32_t>(layout.fragments.size()), 0, 0.0f, 0.0f});
+        x = 0.0f;
+    };
+
+    for (const auto& run : line)
+    {
+        const auto& resolved = mResolvedFonts[run.styleId];
+        ImFont* font = resolved.font;
+        auto fontSize = resolved.fontSize;
+
+        if (mGlyphCache)
+            mGlyphCache->Request(run.text);
 
-            float widthRemaining = ImGui::CalcWrapWidthForPos(drawCursor, 0.0f);
-            const char* drawEnd = font->CalcWordWrapPositionA(1.0f, textStart, textEnd, wrapWidth, wrapWidth - widthRemaining);
-            
-            if (textStart == drawEnd)
+        const char* textStart = run.text.data();
+        const char* textEnd = textStart + run.text.size();
+
+        while (textStart < textEnd)
+        {
+            const char* drawEnd = font->CalcWordWrapPositionA(resolved.scale, textStart, textEnd, wrapWidth, x);
+
+            if (drawEnd == textStart)
             {
-                // Start a new line.
-                if (widthRemaining == drawCursorStart.x - drawCursor.x)
-                    break;
+                // Nothing more fits on this line, continue on the next one. A line that
+                // cannot even hold one character still takes one to always make progress.
+                if (x > 0.0f)
+                {
+                    newLine();
+                    continue;
+                }
+                drawEnd = std::min(textEnd, textStart + UTF8CharLength(*textStart));
+            }
 
-                drawCursor.x = drawCursorStart.x;
-                lineStartY = drawCursor.y += maxFontSize;
+            auto width = font->CalcTextSizeA(fontSize, FLT_MAX, -1.0f, textStart, drawEnd).x;
 
-                widthRemaining = ImGui::CalcWrapWidthForPos(drawCursor, 0.0f);
-                drawEnd = font->CalcWordWrapPositionA(1.0f, textStart, textEnd, wrapWidth, wrapWidth - widthRemaining);
+            auto& current = layout.lines.back();
+            current.fragmentCount++;
+            current.height = std::max(current.height, fontSize);
+            current.descent = std::max(current.descent, resolved.descent);
+            layout.fragments.push_back(LayoutFragment{
+                static_cast<uint32_t>(run.offset + (textStart - run.text.data()) - lineStart),
+                static_cast<uint32_t>(drawEnd - textStart),
+                x, width, run.styleId});
+
+            x += width;
+            textStart = drawEnd;
+
+            if (textStart < textEnd)
+            {
+                // Wrapped inside this run, blanks at the wrap point are not drawn.
+                while (textStart < textEnd && ImCharIsBlankA(*textStart))
+                    textStart++;
+                newLine();
             }
+        }
+    }
 
-            // Calculate the text mathematics for this block.
-            auto fontSizeDifference = maxFontSize - (block.fontSize * mDpiScaling);
-            auto textSize = font->CalcTextSizeA(block.fontSize * mDpiScaling, FLT_MAX, -1.0f, textStart, drawEnd);
+    layout.height = 0.0f;
+    for (auto& current : layout.lines)
+    {
+        if (current.fragmentCount == 0)
+            current.height = mDefaultFontSize * mDpiScaling;
+        layout.height += current.height;
+    }
 
-            
-            auto baselineHeight =  ImLinearRemapClamp(0, font->FontSize, 0, block.fontSize * mDpiScaling, std::abs(font->Descent)); 
-            auto baselineDifference = maxBaseline - baselineHeight;
-            drawCursor = ImVec2(drawCursor.x, lineStartY + fontSizeDifference - baselineDifference); //  - fontSizeDifference - baselineDifference
-            auto textRect = ImRect(drawCursor.x, drawCursor.y, drawCursor.x + textSize.x, drawCursor.y + textSize.y);
+    layout.naturalWidth = layout.lines.size() == 1 ? x : FLT_MAX;
+}
 
-            drawList->AddRect(textRect.Min, textRect.Max, IM_COL32(0, 255, 0, 255));
+void RichTextEditor::DrawParagraph(const ParagraphLayout& layout, std::size_t paragraphStart, ImVec2 origin, float visibleMinY, float visibleMaxY)
+{
+    auto drawList = ImGui::GetWindowDrawList();
+    auto lineStartY = origin.y;
 
-            // Consider the difference in baseline of different font sizes.
+    for (const auto& line : layout.lines)
+    {
+        if (lineStartY >= visibleMaxY)
+            break;
 
-            drawList->AddText(font, block.fontSize * mDpiScaling, drawCursor, block.foregroundColor, textStart, textStart==drawEnd ? nullptr : drawEnd, 0.0f, nullptr);
-            
-            drawCursor = ImVec2{drawCursor.x + textSize.x, drawCursor.y};
-            
-            drawList->AddRectFilled(textRect.Min, textRect.Max, block.backgroundColor);
+        if (lineStartY + line.height <= visibleMinY)
+        {
+            lineStartY += line.height;
+            continue;
+        }
 
+        for (uint32_t i = line.firstFragment; i < line.firstFragment + line.fragmentCount; i++)
+        {
+            const auto& fragment = layout.fragments[i];
+            const auto& resolved = mResolvedFonts[fragment.style];
+            auto fragmentStart = paragraphStart + fragment.offset;
 
-            //if (ImGui::ButtonBehavior(textRect, 0x00, nullptr, nullptr, ImGuiButtonFlags_PressedOnClick))
+            // A fragment never crosses a style change, so this is a single run.
+            for (const auto& run : mDoc->GetRange(fragmentStart, fragmentStart + fragment.length))
             {
+                const auto& block = *run.style;
+
+                // Consider the difference in baseline of different font sizes.
+                auto fontSizeDifference = line.height - resolved.fontSize;
+                auto baselineDifference = line.descent - resolved.descent;
+                auto drawCursor = ImVec2(origin.x + fragment.x, lineStartY + fontSizeDifference - baselineDifference);
+                auto textRect = ImRect(drawCursor.x, drawCursor.y, drawCursor.x + fragment.width, drawCursor.y + resolved.fontSize);
+
+                if (block.backgroundColor)
+                    drawList->AddRectFilled(textRect.Min, textRect.Max, block.backgroundColor);
+
+                drawList->AddText(resolved.font, resolved.fontSize, drawCursor, block.foregroundColor, run.text.data(), run.text.data() + run.text.size(), 0.0f, nullptr);
 
+                if (block.propertyFlags & RichTextPropertyFlags_Underline)
+                {
+                    // To compute the underline position and thickness is a well educated guess here.
+                    // Font files often *do* define an underline position and thickness in their files but it would be hard to obtain here.
+
+                    auto thickness = std::round((line.height / 24.0f) * 0.5f) * 2 + 1;
+                    auto underlineY = std::round(textRect.Min.y + resolved.fontSize - resolved.descent + thickness) + 1;
+                    drawList->AddLine(ImVec2(textRect.Min.x, underlineY), ImVec2(textRect.Max.x, underlineY), block.foregroundColor, thickness);
+                }
             }
+        }
 
-            if (block.propertyFlags & RichTextPropertyFlags_Underline)
-            {
-                ImVec2 lineEnd = ImGui::GetItemRectMax();
-                ImVec2 lineStart = lineEnd;
-                lineStart.x = ImGui::GetItemRectMin().x;
+        lineStartY += line.height;
+    }
+}
 
-                // To compute the underline position and thickness is a well educated guess here.
-                // Font files often *do* define an underline position and thickness in their files but it would be hard to obtain here.
+void RichTextEditor::Render() 
+{
+    auto allocationsBefore = AllocationCounter::GetAllocationCount();
 
-                auto thickness = std::round((maxFontSize / 24.0f) * 0.5f) * 2 + 1;
-                auto underlineStart = ImVec2(textRect.Min.x, std::round(textRect.Min.y + block.fontSize * mDpiScaling - baselineHeight + thickness) + 1);
-                auto underlineEnd = ImVec2(textRect.Max.x, std::round(textRect.Min.y + block.fontSize * mDpiScaling - baselineHeight + thickness) + 1);
-                drawList->AddLine(underlineStart, underlineEnd, block.foregroundColor, thickness);
+    // The editor scrolls inside its own child window, only the lines that intersect the
+    // visible part of it (plus a little overscan) ever reach the draw list.
+    auto footerHeight = mPaginator ? ImGui::GetFrameHeightWithSpacing() : 0.0f;
+    ImGui::BeginChild("##RichTextEditor", ImVec2(0.0f, -footerHeight), ImGuiChildFlags_None, ImGuiWindowFlags_NoNavInputs);
 
-                //drawList->AddLine(lineStart, lineEnd, block.foregroundColor);
+    HandleKeyboardInput();
 
-                if (ImGui::IsItemHovered(ImGuiHoveredFlags_RectOnly))
-                    ImGui::SetMouseCursor(ImGuiMouseCursor_TextInput);
-            }
+    auto drawList = ImGui::GetWindowDrawList();
+    auto window = ImGui::GetCurrentWindow();
 
-            if (textStart == drawEnd || drawEnd == textEnd)
-            {
-                // ImGui::SameLine(0.0f, 0.0f);
-                // auto cursorScreenLocation= ImGui::GetCursorScreenPos();
-                // cursorScreenLocation.x += textSize.x;
-                // ImGui::SetCursorScreenPos(cursorScreenLocation);
-                break;
-            }
+    // Draw the background for the editor.
+    auto drawCursorStart = ImGui::GetCursorScreenPos();
+    auto wrapWidth = ImGui::GetContentRegionAvail().x;
+    drawList->AddRectFilled(window->InnerRect.Min, window->InnerRect.Max, 0xFFe0e0e0);
 
-            textStart = drawEnd;
+    if (mDoc)
+    {
+        // Layout is cached per paragraph, a steady frame only binary searches the prefix
+        // sums for the first visible paragraph and draws from there.
+        UpdateLayout(wrapWidth);
 
-            while (textStart < textEnd)
-            {
-                const char c = *textStart;
-                if (ImCharIsBlankA(c)) { textStart++; }
-                else if (c == '\n') { 
-                    textStart++; 
+        auto overscan = 2.0f * mDefaultFontSize * mDpiScaling;
+        auto visibleMinY = window->InnerRect.Min.y - overscan;
+        auto visibleMaxY = window->InnerRect.Max.y + overscan;
 
-                    // Look ahead for the next new line and set the line baselines.
-                    //getLineData();
+        auto first = std::upper_bound(mParagraphOffsets.begin(), mParagraphOffsets.end(), visibleMinY - drawCursorStart.y);
+        auto paragraph = static_cast<std::size_t>(std::max<std::ptrdiff_t>(0, (first - mParagraphOffsets.begin()) - 1));
+        mFirstVisibleParagraph = paragraph;
 
-                    drawCursor.x = drawCursorStart.x;
-                    lineStartY += maxFontSize;
-                    break;
-                }
-                else { break; }
-            }
+        for (; paragraph < mLayout.size(); paragraph++)
+        {
+            auto paragraphY = drawCursorStart.y + mParagraphOffsets[paragraph];
+            if (paragraphY >= visibleMaxY)
+                break;
+
+            DrawParagraph(mLayout[paragraph], mDoc->GetLineStart(paragraph), ImVec2(drawCursorStart.x, paragraphY), visibleMinY, visibleMaxY);
+        }
 
-            drawCursor.x = drawCursorStart.x;
-            lineStartY += maxFontSize;
-        } while (true);
+        // Reserve the full document height so the child window scrolls over all of it.
+        ImGui::Dummy(ImVec2(wrapWidth, mParagraphOffsets.back()));
     }
 
-    drawList->PopClipRect();
+    ImGui::EndChild();
+
+    // Pagination resumes where the edits were, keeping the count live costs little.
+    if (mPaginator && mDoc)
+    {
+        mPaginator->Update();
+        ImGui::Text("Page %zu of %zu", mPaginator->GetPageAt(mFirstVisibleParagraph) + 1, mPaginator->GetPageCount());
+    }
 
+    // A steady frame should never touch the heap, this is shown in the inspector for debug builds.
+    mLastFrameAllocations = AllocationCounter::GetAllocationCount() - allocationsBefore;
 }
 
 void RichTextEditor::DrawCursor()
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include "imgui.h"
+#include "FontGlyphCache.h"
 #include "RichTextDocument.h"
+#include "script.hpp"
 
 class RichTextEditor {
 public:
@@ -11,13 +16,57 @@ public:
     void SetCursorLocation(int line, int column);
     void SetDocument(RichTextDocument& doc);
     void SetDPIScaling(float dpiScaling);
+    void SetFonts(ImFont* normalFont, ImFont* boldFont, ImFont* italicFont, ImFont* italicBoldFont);
+    void SetGlyphCache(FontGlyphCache* glyphCache); // Layout requests the glyphs it measures from the cache.
+    void SetPaginator(ScriptPaginator* paginator); // Shows "page X of Y" under the text, the paginator must follow the same document.
     void Render();
+    std::size_t GetLastFrameAllocations() const { return mLastFrameAllocations; }
 
 private:
+    // Layout of one paragraph (one document line), cached until an edit touches the
+    // paragraph or the wrap width or DPI scale change. Offsets are paragraph relative so
+    // edits elsewhere in the document leave the cache valid.
+    struct LayoutFragment {
+        uint32_t offset;
+        uint32_t length;
+        float x;
+        float width;
+        RichTextStyleId style;
+    };
+
+    // What a style draws with at the current DPI scaling. Resolved once per interned style
+    // and rebuilt only when the fonts or the DPI scaling change.
+    struct ResolvedFont {
+        ImFont* font;
+        float fontSize;
+        float scale;
+        float descent;
+    };
+
+    struct LayoutLine {
+        uint32_t firstFragment;
+        uint32_t fragmentCount;
+        float height;
+        float descent;
+    };
+
+    struct ParagraphLayout {
+        bool valid = false;
+        float wrapWidth = 0.0f;
+        float dpiScaling = 0.0f;
+        float naturalWidth = 0.0f;
+        float height = 0.0f;
+        std::vector<LayoutLine> lines;
+        std::vector<LayoutFragment> fragments;
+    };
+
     void HandleKeyboardInput();
-    void ComputeLineAttributes(std::list<RichTextBlock>& block, float& maxFontSize, float& maxBaseline);
+    void UpdateLayout(float wrapWidth);
+    void LayoutParagraph(std::size_t paragraph, ParagraphLayout& layout, float wrapWidth);
+    void DrawParagraph(const ParagraphLayout& layout, std::size_t paragraphStart, ImVec2 origin, float visibleMinY, float visibleMaxY);
     void DrawCursor();
-    ImFont* GetBlockFont(RichTextPropertyFlags properties);
+    void UpdateFontTable();
+    ImFont* GetBlockFont(RichTextPropertyFlags properties) const;
     std::size_t UTF8CharLength(char c);
 
     float mDpiScaling = 1.0f;
@@ -27,6 +76,23 @@ private:
     int mCursorColumn;
     ImU32 mCursorColor;
     RichTextDocument* mDoc;
+    std::size_t mLastFrameAllocations = 0;
+
+    std::vector<ParagraphLayout> mLayout;
+    std::vector<float> mParagraphOffsets; // Prefix sums of paragraph heights, one entry more than mLayout.
+    std::vector<RichTextChange> mLayoutChanges;
+    uint64_t mLayoutVersion = 0;
+    float mLayoutWrapWidth = 0.0f;
+    float mLayoutDpiScaling = 0.0f;
+
+    std::vector<ResolvedFont> mResolvedFonts; // Indexed by style id.
+    float mResolvedFontsDpiScaling = 0.0f;
+
+    FontGlyphCache* mGlyphCache = nullptr;
+    uint32_t mLayoutGlyphGeneration = 0;
+
+    ScriptPaginator* mPaginator = nullptr;
+    std::size_t mFirstVisibleParagraph = 0;
 
     ImFont* mNormalFont;
     ImFont* mBoldFont;
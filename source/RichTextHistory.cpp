@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cassert>
+
+#include "RichTextHistory.h"
+
+RichTextHistory::RichTextHistory()
+{
+}
+
+void RichTextHistory::RecordInsert(std::size_t offset, const Piece& piece)
+{
+    if (piece.length == 0) return;
+
+    // Typing continues the last insert, the new text usually follows the last piece in the
+    // add buffer so the piece simply grows.
+    if (mCanCoalesce && !CanRedo() && !mOperations.empty())
+    {
+        auto& operation = mOperations.back();
+        if (operation.type == OperationType::Insert && offset == operation.offset + operation.length)
+        {
+            auto& last = mPieces.back();
+            if (last.buffer == piece.buffer && last.style == piece.style && last.start + last.length == piece.start)
+                last.length += piece.length;
+            else
+            {
+                mPieces.push_back(piece);
+                operation.pieceCount++;
+            }
+
+            operation.length += piece.length;
+            EnforceBudget();
+            return;
+        }
+    }
+
+    auto operation = BeginOperation(OperationType::Insert, offset);
+    operation->length = piece.length;
+    operation->pieceCount = 1;
+    mPieces.push_back(piece);
+    EnforceBudget();
+}
+
+void RichTextHistory::RecordRemove(std::size_t start, std::size_t end, const PieceTable& pieces)
+{
+    if (start >= end) return;
+
+    auto appendPieces = [&](Operation& operation) {
+        pieces.ForEachPieceIn(start, end, [&](const Piece& piece) {
+            mPieces.push_back(piece);
+            operation.pieceCount++;
+        });
+        operation.length += end - start;
+    };
+
+    // Backspacing removes text just before the last removal, deleting removes text at the
+    // same offset. Both grow the last removal instead of starting a new step.
+    if (mCanCoalesce && !CanRedo() && !mOperations.empty())
+    {
+        auto& operation = mOperations.back();
+        if (operation.type == OperationType::Remove && end == operation.offset)
+        {
+            auto oldEnd = mPieces.size();
+            appendPieces(operation);
+            std::rotate(mPieces.begin() + operation.firstPiece, mPieces.begin() + oldEnd, mPieces.end());
+            operation.offset = start;
+            EnforceBudget();
+            return;
+        }
+        else if (operation.type == OperationType::Remove && start == operation.offset)
+        {
+            appendPieces(operation);
+            EnforceBudget();
+            return;
+        }
+    }
+
+    appendPieces(*BeginOperation(OperationType::Remove, start));
+    EnforceBudget();
+}
+
+void RichTextHistory::BeginGroup()
+{
+    if (mGroupDepth++ == 0)
+    {
+        mGroupRecordOpen = false;
+        mCanCoalesce = false;
+    }
+}
+
+void RichTextHistory::EndGroup()
+{
+    assert(mGroupDepth > 0);
+    if (--mGroupDepth == 0)
+    {
+        mGroupRecordOpen = false;
+        mCanCoalesce = false;
+    }
+}
+
+void RichTextHistory::BreakCoalescing()
+{
+    // Inside a group everything ends up in one step regardless.
+    if (mGroupDepth == 0)
+        mCanCoalesce = false;
+}
+
+void RichTextHistory::Clear()
+{
+    mRecords.clear();
+    mOperations.clear();
+    mPieces.clear();
+    mUndoCount = 0;
+    mGroupRecordOpen = false;
+    mCanCoalesce = false;
+}
+
+const RichTextHistory::Record* RichTextHistory::Undo()
+{
+    if (!CanUndo()) return nullptr;
+    mCanCoalesce = false;
+    mGroupRecordOpen = false;
+    return &mRecords[--mUndoCount];
+}
+
+const RichTextHistory::Record* RichTextHistory::Redo()
+{
+    if (!CanRedo()) return nullptr;
+    mCanCoalesce = false;
+    mGroupRecordOpen = false;
+    return &mRecords[mUndoCount++];
+}
+
+void RichTextHistory::SetMemoryBudget(std::size_t bytes)
+{
+    mMemoryBudget = bytes;
+    EnforceBudget();
+}
+
+std::size_t RichTextHistory::GetMemoryUsage() const
+{
+    return mRecords.size() * sizeof(Record) + mOperations.size() * sizeof(Operation) + mPieces.size() * sizeof(Piece);
+}
+
+RichTextHistory::Operation* RichTextHistory::BeginOperation(OperationType type, std::size_t offset)
+{
+    DiscardRedo();
+
+    if (mGroupDepth == 0 || !mGroupRecordOpen)
+    {
+        mRecords.push_back(Record{mOperations.size(), 0});
+        mUndoCount = mRecords.size();
+        mGroupRecordOpen = mGroupDepth > 0;
+    }
+
+    mRecords.back().operationCount++;
+    mOperations.push_back(Operation{type, offset, 0, mPieces.size(), 0});
+    mCanCoalesce = true;
+    return &mOperations.back();
+}
+
+void RichTextHistory::DiscardRedo()
+{
+    if (!CanRedo()) return;
+
+    const auto firstOperation = mRecords[mUndoCount].firstOperation;
+    mPieces.resize(mOperations[firstOperation].firstPiece);
+    mOperations.resize(firstOperation);
+    mRecords.resize(mUndoCount);
+}
+
+void RichTextHistory::EnforceBudget()
+{
+    if (GetMemoryUsage() <= mMemoryBudget) return;
+
+    // Forget the oldest steps until comfortably under budget, so the erase below is paid
+    // for once every few edits rather than on every one of them.
+    const std::size_t target = mMemoryBudget / 4 * 3;
+    const std::size_t droppable = std::min(mUndoCount, mRecords.size() - 1);
+    std::size_t usage = GetMemoryUsage();
+    std::size_t dropped = 0;
+
+    while (dropped < droppable && usage > target)
+    {
+        const auto& record = mRecords[dropped];
+        usage -= sizeof(Record) + record.operationCount * sizeof(Operation);
+        for (std::size_t i = 0; i < record.operationCount; i++)
+            usage -= mOperations[record.firstOperation + i].pieceCount * sizeof(Piece);
+        dropped++;
+    }
+
+    if (dropped == 0) return;
+
+    const auto operationsDropped = mRecords[dropped].firstOperation;
+    const auto piecesDropped = mOperations[operationsDropped].firstPiece;
+
+    mRecords.erase(mRecords.begin(), mRecords.begin() + dropped);
+    mOperations.erase(mOperations.begin(), mOperations.begin() + operationsDropped);
+    mPieces.erase(mPieces.begin(), mPieces.begin() + piecesDropped);
+
+    for (auto& record : mRecords)
+        record.firstOperation -= operationsDropped;
+    for (auto& operation : mOperations)
+        operation.firstPiece -= piecesDropped;
+
+    mUndoCount -= dropped;
+}
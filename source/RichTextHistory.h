@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PieceTable.h"
+
+// Undo history for a piece table. Edits are stored as pieces, references into the table's
+// append-only buffers, so a step costs a few dozen bytes however much text it touched and
+// however large the document is. Consecutive typing and deleting merge into one step.
+class RichTextHistory {
+public:
+    enum class OperationType : uint8_t {
+        Insert,
+        Remove
+    };
+
+    // Text covering [offset, offset + length) was inserted or removed, the text itself is
+    // the operation's pieces in document order.
+    struct Operation {
+        OperationType type;
+        std::size_t offset;
+        std::size_t length;
+        std::size_t firstPiece;
+        std::size_t pieceCount;
+    };
+
+    // One undo step, a run of operations applied in order.
+    struct Record {
+        std::size_t firstOperation;
+        std::size_t operationCount;
+    };
+
+    RichTextHistory();
+    ~RichTextHistory() = default;
+
+    /// RECORDING ///
+    void RecordInsert(std::size_t offset, const Piece& piece);
+    void RecordRemove(std::size_t start, std::size_t end, const PieceTable& pieces); // Call before removing.
+    void BeginGroup(); // Everything until the matching EndGroup is one step.
+    void EndGroup();
+    void BreakCoalescing(); // The next edit starts a new step.
+    void Clear();
+
+    /// UNDO AND REDO ///
+    // Return the step to apply, nullptr when there is none. Undo the operations in reverse.
+    const Record* Undo();
+    const Record* Redo();
+    bool CanUndo() const { return mUndoCount > 0; }
+    bool CanRedo() const { return mUndoCount < mRecords.size(); }
+    const Operation& GetOperation(std::size_t index) const { return mOperations[index]; }
+    const Piece* GetPieces(const Operation& operation) const { return mPieces.data() + operation.firstPiece; }
+
+    /// MEMORY ///
+    // Once over budget the oldest steps are forgotten, at least the newest step is always kept.
+    void SetMemoryBudget(std::size_t bytes);
+    std::size_t GetMemoryBudget() const { return mMemoryBudget; }
+    std::size_t GetMemoryUsage() const;
+    std::size_t GetStepCount() const { return mRecords.size(); }
+
+private:
+    Operation* BeginOperation(OperationType type, std::size_t offset);
+    void DiscardRedo();
+    void EnforceBudget();
+
+    std::vector<Record> mRecords;
+    std::vector<Operation> mOperations;
+    std::vector<Piece> mPieces;
+    std::size_t mUndoCount = 0;  // Records before this index are undoable, the rest redoable.
+    std::size_t mGroupDepth = 0;
+    bool mGroupRecordOpen = false; // The current group already has its record.
+    bool mCanCoalesce = false;     // The last record may still grow by typing or deleting.
+    std::size_t mMemoryBudget = 4 * 1024 * 1024;
+};
@@ -0,0 +1,63 @@
+#include <functional>
+
+#include "RichTextStyle.h"
+
+static std::size_t HashCombine(std::size_t seed, std::size_t value)
+{
+    return seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2));
+}
+
+bool RichTextStyle::operator==(const RichTextStyle& other) const
+{
+    return propertyFlags == other.propertyFlags
+        && fontSize == other.fontSize
+        && foregroundColor == other.foregroundColor
+        && backgroundColor == other.backgroundColor
+        && additionalProperties == other.additionalProperties;
+}
+
+std::size_t RichTextStyle::Hash() const
+{
+    auto hash = std::hash<int>()(propertyFlags);
+    hash = HashCombine(hash, std::hash<float>()(fontSize));
+    hash = HashCombine(hash, std::hash<uint32_t>()(foregroundColor));
+    hash = HashCombine(hash, std::hash<uint32_t>()(backgroundColor));
+
+    // The map has no defined order, so its entries are summed rather than chained.
+    std::size_t properties = 0;
+    for (const auto& property : additionalProperties)
+        properties += HashCombine(std::hash<std::string>()(property.first), std::hash<RichTextPropertyValue>()(property.second));
+
+    return HashCombine(hash, properties);
+}
+
+RichTextStyleTable::RichTextStyleTable()
+{
+    Clear();
+}
+
+RichTextStyleId RichTextStyleTable::Intern(const RichTextStyle& style)
+{
+    auto hash = style.Hash();
+    auto range = mLookup.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (mStyles[it->second] == style)
+            return it->second;
+    }
+
+    auto id = static_cast<RichTextStyleId>(mStyles.size());
+    mStyles.push_back(style);
+    mLookup.emplace(hash, id);
+    return id;
+}
+
+void RichTextStyleTable::Clear()
+{
+    mStyles.clear();
+    mLookup.clear();
+
+    // The default style always exists and always has the id zero.
+    mStyles.emplace_back();
+    mLookup.emplace(mStyles.front().Hash(), kDefaultStyle);
+}
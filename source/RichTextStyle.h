@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+typedef int RichTextPropertyFlags;
+enum RichTextPropertyFlagBits {
+    RichTextPropertyFlags_Bold = 0x00000001,
+    RichTextPropertyFlags_Italic = 0x00000002,
+    RichTextPropertyFlags_Underline = 0x00000004,
+    RichTextPropertyFlags_Centered = 0x00000008,
+    RichTextPropertyFlags_RightAligned = 0x00000010,
+    RichTextPropertyFlag_IsLine = 0x00000020
+};
+
+using RichTextPropertyValue = std::variant<std::string, float, int, bool, uint32_t /* colors, see RichTextColor.h */>;
+
+class RichTextStyle {
+public:
+    RichTextStyle()
+        : propertyFlags(0)
+        , fontSize(18.0f)
+        , foregroundColor(0xFF000000)
+        , backgroundColor(0x0)
+        , additionalProperties()
+    {
+    }
+
+    RichTextPropertyFlags propertyFlags;
+    float fontSize;
+    uint32_t foregroundColor;
+    uint32_t backgroundColor;
+    std::unordered_map<std::string, RichTextPropertyValue> additionalProperties;
+
+    bool operator==(const RichTextStyle& other) const;
+    bool operator!=(const RichTextStyle& other) const { return !(*this == other); }
+    std::size_t Hash() const;
+};
+
+// Styles are interned: every distinct style is stored once and text refers to it by id,
+// so comparing the styles of two runs is comparing two integers.
+typedef uint32_t RichTextStyleId;
+
+class RichTextStyleTable {
+public:
+    RichTextStyleTable();
+
+    static constexpr RichTextStyleId kDefaultStyle = 0;
+
+    RichTextStyleId Intern(const RichTextStyle& style);
+    const RichTextStyle& Get(RichTextStyleId id) const { return mStyles[id]; }
+    std::size_t GetStyleCount() const { return mStyles.size(); }
+    void Clear();
+
+private:
+    std::vector<RichTextStyle> mStyles;
+    std::unordered_multimap<std::size_t, RichTextStyleId> mLookup; // Style hash to id.
+};
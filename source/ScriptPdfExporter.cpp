@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <cstdio>
+
+#include <Poco/Environment.h>
+#include <Poco/Exception.h>
+#include <Poco/Runnable.h>
+#include <Poco/PDF/Document.h>
+#include <Poco/PDF/Font.h>
+#include <Poco/PDF/Page.h>
+
+#include "ScriptPdfExporter.h"
+#include "ScriptProject.h"
+
+// Pages laid out before they are written, two chunks are alive at a time.
+static constexpr std::size_t kPagesPerChunk = 64;
+
+// US Letter in points with 12 pt Courier, six lines and ten characters to the inch.
+static constexpr float kPageHeight = 792.0f;
+static constexpr float kPointsPerLine = 12.0f;
+static constexpr float kPointsPerCharacter = 7.2f;
+static constexpr float kTopMargin = 72.0f;
+static constexpr float kBaseline = 9.0f;
+static constexpr float kPageNumberRight = 540.0f; // 7.5", the number sits half an inch from the top.
+
+static int GetThreadCount(int threadCount)
+{
+    return threadCount > 0 ? threadCount : std::max(1, static_cast<int>(Poco::Environment::processorCount()));
+}
+
+// Converts UTF-8 to WinAnsiEncoding, the encoding of the standard Courier font. Characters
+// it cannot show become '?'.
+static void AppendWinAnsi(std::string& out, std::string_view text)
+{
+    for (std::size_t i = 0; i < text.size();)
+    {
+        auto lead = static_cast<unsigned char>(text[i]);
+        if (lead < 0x80)
+        {
+            out += static_cast<char>(lead);
+            i++;
+            continue;
+        }
+
+        auto length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+        uint32_t codepoint = length == 4 ? lead & 0x07 : length == 3 ? lead & 0x0F : lead & 0x1F;
+        for (int k = 1; k < length && i + k < text.size(); k++)
+            codepoint = (codepoint << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+        i += length;
+
+        char converted = '?';
+        if (codepoint >= 0xA0 && codepoint <= 0xFF)
+            converted = static_cast<char>(codepoint);
+        else if (codepoint == 0x2018) converted = '\x91';
+        else if (codepoint == 0x2019) converted = '\x92';
+        else if (codepoint == 0x201C) converted = '\x93';
+        else if (codepoint == 0x201D) converted = '\x94';
+        else if (codepoint == 0x2022) converted = '\x95';
+        else if (codepoint == 0x2013) converted = '\x96';
+        else if (codepoint == 0x2014) converted = '\x97';
+        else if (codepoint == 0x2026) converted = '\x85';
+        else if (codepoint == 0x20AC) converted = '\x80';
+        out += converted;
+    }
+}
+
+// Lays out pages handed out through the exporter's counter until the chunk runs dry.
+class ScriptPdfExporter::LayoutTask : public Poco::Runnable {
+public:
+    explicit LayoutTask(ScriptPdfExporter* exporter)
+        : mExporter(exporter)
+    {
+    }
+
+    void run() override { mExporter->LayoutPages(mScratch, mLines); }
+
+private:
+    ScriptPdfExporter* mExporter;
+    std::string mScratch;
+    std::vector<std::string_view> mLines;
+};
+
+ScriptPdfExporter::ScriptPdfExporter(int threadCount)
+    : mPool(GetThreadCount(threadCount), GetThreadCount(threadCount))
+{
+    for (int i = 0; i < GetThreadCount(threadCount); i++)
+        mTasks.push_back(std::make_unique<LayoutTask>(this));
+}
+
+ScriptPdfExporter::~ScriptPdfExporter()
+{
+    mPool.joinAll();
+}
+
+std::size_t ScriptPdfExporter::ExportBatch(const std::vector<Job>& jobs)
+{
+    std::size_t exported = 0;
+    std::size_t pages = 0;
+    std::size_t peak = 0;
+    for (const auto& job : jobs)
+    {
+        if (job.doc && Export(*job.doc, job.path))
+            exported++;
+        pages += mLastPageCount;
+        peak = std::max(peak, mPeakLayoutBytes);
+    }
+
+    mLastPageCount = pages;
+    mPeakLayoutBytes = peak;
+    return exported;
+}
+
+std::size_t ScriptPdfExporter::ExportBatch(const ScriptProject& project, const std::string& projectPathBase)
+{
+    std::vector<Job> jobs;
+    for (const auto& script : project.GetScripts())
+        jobs.push_back(Job{&script.doc, ScriptProject::GetScriptPathBase(projectPathBase, jobs.size()) + ".pdf"});
+    return ExportBatch(jobs);
+}
+
+bool ScriptPdfExporter::Export(const RichTextDocument& doc, const std::string& path)
+{
+    mLastPageCount = 0;
+    mPeakLayoutBytes = 0;
+
+    // Breaks first, they are the only thing pages depend on each other for.
+    ScriptPaginator paginator(&doc, mMetrics);
+    paginator.Update();
+    mPaginator = &paginator;
+
+    auto pageCount = paginator.GetPageCount();
+    std::vector<PageLayout> chunks[2];
+    std::string text;
+
+    try
+    {
+        Poco::PDF::Document pdf(static_cast<Poco::UInt32>(pageCount));
+        pdf.compression(Poco::PDF::Document::COMPRESSION_ALL);
+        const Poco::PDF::Font& font = pdf.font("Courier", "WinAnsiEncoding");
+
+        StartLayout(chunks[0], 0, std::min(kPagesPerChunk, pageCount));
+        mPool.joinAll();
+
+        for (std::size_t chunkStart = 0, chunk = 0; chunkStart < pageCount; chunkStart += kPagesPerChunk, chunk ^= 1)
+        {
+            // The pool lays out the next chunk while this one is written.
+            auto nextStart = chunkStart + kPagesPerChunk;
+            if (nextStart < pageCount)
+                StartLayout(chunks[chunk ^ 1], nextStart, std::min(nextStart + kPagesPerChunk, pageCount));
+
+            const auto& layouts = chunks[chunk];
+            for (std::size_t i = 0; i < layouts.size(); i++)
+            {
+                Poco::PDF::Page page = pdf[chunkStart + i];
+                page.setFont(font, 12.0f);
+                page.beginText();
+                for (const auto& line : layouts[i].lines)
+                {
+                    text.assign(layouts[i].text, line.offset, line.length);
+                    page.write(line.x, line.y, text);
+                }
+                page.endText();
+            }
+
+            mPool.joinAll();
+            mPeakLayoutBytes = std::max(mPeakLayoutBytes, GetLayoutBytes(chunks[0]) + GetLayoutBytes(chunks[1]));
+        }
+
+        pdf.save(path);
+    }
+    catch (const Poco::Exception&)
+    {
+        mPool.joinAll();
+        mPaginator = nullptr;
+        return false;
+    }
+
+    mPaginator = nullptr;
+    mLastPageCount = pageCount;
+    return true;
+}
+
+void ScriptPdfExporter::StartLayout(std::vector<PageLayout>& chunk, std::size_t firstPage, std::size_t endPage)
+{
+    // Layouts keep their buffers from earlier chunks, so a long script stops allocating
+    // after the first two.
+    chunk.resize(endPage - firstPage);
+    mChunk = &chunk;
+    mChunkStart = firstPage;
+    mChunkEnd = endPage;
+    mNextPage = firstPage;
+
+    for (auto& task : mTasks)
+        mPool.start(*task);
+}
+
+void ScriptPdfExporter::LayoutPages(std::string& scratch, std::vector<std::string_view>& lines)
+{
+    for (auto page = mNextPage++; page < mChunkEnd; page = mNextPage++)
+        LayoutPage(page, (*mChunk)[page - mChunkStart], scratch, lines);
+}
+
+void ScriptPdfExporter::LayoutPage(std::size_t page, PageLayout& layout, std::string& scratch, std::vector<std::string_view>& lines) const
+{
+    const auto& paginator = *mPaginator;
+    const auto& classifier = paginator.GetClassifier();
+    auto paragraphCount = classifier.GetParagraphCount();
+    auto start = paginator.GetPageStart(page);
+    auto end = page + 1 < paginator.GetPageCount() ? paginator.GetPageStart(page + 1) : ScriptPaginator::PageStart{paragraphCount, 0, false};
+
+    layout.text.clear();
+    layout.lines.clear();
+
+    // Every page but the first is numbered in the top right corner.
+    if (page > 0)
+    {
+        char number[24];
+        auto length = std::snprintf(number, sizeof(number), "%zu.", page + 1);
+        layout.lines.push_back(PageLine{kPageNumberRight - length * kPointsPerCharacter, kPageHeight - kTopMargin / 2.0f - kBaseline, static_cast<uint32_t>(layout.text.size()), static_cast<uint32_t>(length)});
+        layout.text.append(number, length);
+    }
+
+    // Rows past the page's lines are dropped rather than run off the bottom, the paginator
+    // never fills more than that.
+    std::size_t row = 0;
+    const auto rows = mMetrics.linesPerPage;
+    auto indent = [this](ScriptWritingState element) { return mMetrics.GetIndent(element) * kPointsPerCharacter; };
+
+    // Dialogue carried over from the page before picks up under its cue again.
+    if (start.continued)
+    {
+        auto cue = start.paragraph;
+        while (cue > 0 && classifier.GetElement(cue) != ScriptWritingState::eCharacter)
+            cue--;
+        AddLine(layout, indent(ScriptWritingState::eCharacter), row++, paginator.GetParagraphText(cue, scratch), " (CONT'D)");
+    }
+
+    for (auto paragraph = start.paragraph; row < rows && paragraph < paragraphCount && (paragraph < end.paragraph || (paragraph == end.paragraph && end.line > 0)); paragraph++)
+    {
+        auto element = classifier.GetElement(paragraph);
+        if (element == ScriptWritingState::eNone)
+        {
+            row++;
+            continue;
+        }
+
+        lines.clear();
+        ScriptPaginator::WrapParagraph(paginator.GetParagraphText(paragraph, scratch), mMetrics.GetWidth(element), &lines);
+
+        auto first = paragraph == start.paragraph ? start.line : 0;
+        auto last = paragraph == end.paragraph ? std::min(end.line, lines.size()) : lines.size();
+        for (auto line = first; line < last && row < rows; line++)
+            AddLine(layout, indent(element), row++, lines[line]);
+    }
+
+    if (end.continued && row < rows)
+        AddLine(layout, indent(ScriptWritingState::eCharacter), row, "(MORE)");
+}
+
+void ScriptPdfExporter::AddLine(PageLayout& layout, float x, std::size_t row, std::string_view text, std::string_view suffix) const
+{
+    auto offset = layout.text.size();
+    AppendWinAnsi(layout.text, text);
+    layout.text.append(suffix);
+
+    auto y = kPageHeight - kTopMargin - row * kPointsPerLine - kBaseline;
+    layout.lines.push_back(PageLine{x, y, static_cast<uint32_t>(offset), static_cast<uint32_t>(layout.text.size() - offset)});
+}
+
+std::size_t ScriptPdfExporter::GetLayoutBytes(const std::vector<PageLayout>& chunk)
+{
+    auto bytes = chunk.capacity() * sizeof(PageLayout);
+    for (const auto& layout : chunk)
+        bytes += layout.text.capacity() + layout.lines.capacity() * sizeof(PageLine);
+    return bytes;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Poco/ThreadPool.h>
+
+#include "RichTextDocument.h"
+#include "script.hpp"
+
+class ScriptProject;
+
+// Writes screenplays to PDF the way they are printed: 12 pt Courier on US Letter, broken into
+// pages by ScriptPaginator. Once the breaks are known every page is independent, so pages are
+// laid out on a thread pool a chunk at a time while the calling thread writes the previous
+// chunk into the PDF. Layout memory stays bounded by two chunks however long the script is.
+class ScriptPdfExporter {
+public:
+    struct Job {
+        const RichTextDocument* doc;
+        std::string path;
+    };
+
+    explicit ScriptPdfExporter(int threadCount = 0); // Zero uses one thread per processor.
+    ~ScriptPdfExporter();
+
+    void SetMetrics(const ScriptPageMetrics& metrics) { mMetrics = metrics; }
+
+    // Returns false when the PDF could not be written.
+    bool Export(const RichTextDocument& doc, const std::string& path);
+
+    // Exports one script after another, returns how many were written.
+    std::size_t ExportBatch(const std::vector<Job>& jobs);
+
+    // Exports every script of a project, numbered after it as ScriptProject::GetScriptPathBase
+    // names them. Returns how many were written.
+    std::size_t ExportBatch(const ScriptProject& project, const std::string& projectPathBase);
+
+    // Pages written by the last export or batch, and the most memory page layouts held at once.
+    std::size_t GetLastPageCount() const { return mLastPageCount; }
+    std::size_t GetPeakLayoutBytes() const { return mPeakLayoutBytes; }
+
+private:
+    // Text is already converted to the PDF font's encoding, y is the baseline in points.
+    struct PageLine {
+        float x;
+        float y;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct PageLayout {
+        std::string text;
+        std::vector<PageLine> lines;
+    };
+
+    class LayoutTask;
+
+    void StartLayout(std::vector<PageLayout>& chunk, std::size_t firstPage, std::size_t endPage);
+    void LayoutPages(std::string& scratch, std::vector<std::string_view>& lines);
+    void LayoutPage(std::size_t page, PageLayout& layout, std::string& scratch, std::vector<std::string_view>& lines) const;
+    void AddLine(PageLayout& layout, float x, std::size_t row, std::string_view text, std::string_view suffix = {}) const;
+    static std::size_t GetLayoutBytes(const std::vector<PageLayout>& chunk);
+
+    ScriptPageMetrics mMetrics;
+    Poco::ThreadPool mPool;
+    std::vector<std::unique_ptr<LayoutTask>> mTasks;
+
+    // The chunk being laid out.
+    const ScriptPaginator* mPaginator = nullptr;
+    std::vector<PageLayout>* mChunk = nullptr;
+    std::size_t mChunkStart = 0;
+    std::size_t mChunkEnd = 0;
+    std::atomic<std::size_t> mNextPage{0};
+
+    std::size_t mLastPageCount = 0;
+    std::size_t mPeakLayoutBytes = 0;
+};
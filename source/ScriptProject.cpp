@@ -0,0 +1,97 @@
+#include <string>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+
+#include "ScriptProject.h"
+
+ScriptProject::Script::Script(std::string name, const nlohmann::json& text)
+    : name(std::move(name))
+    , doc(text)
+{
+}
+
+ScriptFileType ScriptProject::GetFileType(std::string_view json)
+{
+    // Only the top level keys matter, so strings and nested values are stepped over without
+    // being decoded. A bare document is usually far larger than a project and is about to be
+    // parsed anyway, this costs a small part of that.
+    auto i = json.find_first_not_of(" \t\r\n");
+    if (i == std::string_view::npos || json[i] != '{')
+        return ScriptFileType::eUnknown;
+
+    int depth = 0;
+    bool key = false;
+    for (; i < json.size(); i++)
+    {
+        auto c = json[i];
+        if (c == '"')
+        {
+            // A quote ends the string unless an odd number of backslashes escape it.
+            auto start = i + 1;
+            do
+                i = json.find('"', i + 1);
+            while (i != std::string_view::npos && (i - json.find_last_not_of('\\', i - 1)) % 2 == 0);
+
+            if (i == std::string_view::npos)
+                break;
+            if (depth == 1 && key && json.substr(start, i - start) == "scripts")
+                return ScriptFileType::eProject;
+            key = false;
+        }
+        else if (c == '{' || c == '[')
+        {
+            depth++;
+            key = c == '{';
+        }
+        else if (c == '}' || c == ']')
+            depth--;
+        else if (c == ',')
+            key = true;
+        else if (c == ':')
+            key = false;
+    }
+
+    return ScriptFileType::eDocument;
+}
+
+bool ScriptProject::Load(std::string_view json)
+{
+    mName.clear();
+    mScripts.clear();
+
+    auto project = nlohmann::json::parse(json, nullptr, false);
+    if (!project.is_object())
+        return false;
+
+    auto scripts = project.find("scripts");
+    if (scripts == project.end() || !scripts->is_array())
+        return false;
+
+    // Every script needs its text, a project with one broken script is not loaded halfway.
+    for (const auto& script : *scripts)
+    {
+        if (!script.is_object())
+            return false;
+        auto text = script.find("text");
+        if (text == script.end() || !text->is_object())
+            return false;
+    }
+
+    for (const auto& script : *scripts)
+    {
+        auto name = script.find("name");
+        mScripts.emplace_back(name != script.end() && name->is_string() ? name->get<std::string>() : std::string(), script["text"]);
+    }
+
+    auto name = project.find("name");
+    if (name != project.end() && name->is_string())
+        mName = name->get<std::string>();
+
+    return true;
+}
+
+std::string ScriptProject::GetScriptPathBase(const std::string& projectPathBase, std::size_t script)
+{
+    return projectPathBase + "-" + std::to_string(script + 1);
+}
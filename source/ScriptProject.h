@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+
+#include <nlohmann/json_fwd.hpp>
+
+#include "RichTextDocument.h"
+
+enum class ScriptFileType {
+    eUnknown,
+    eDocument,
+    eProject
+};
+
+// A project file keeps a story's scripts next to its node graph:
+// {"type": "doc", "name": ..., "scripts": [{"name": ..., "text": <rich text>}, ...], "nodeGraph": ...}
+// A bare rich text document is a single script without the rest.
+class ScriptProject {
+public:
+    struct Script {
+        Script(std::string name, const nlohmann::json& text);
+
+        std::string name;
+        RichTextDocument doc;
+    };
+
+    // Projects are objects with a top level "scripts" key, any other object is a document,
+    // malformed or not. Anything that is not an object is eUnknown.
+    static ScriptFileType GetFileType(std::string_view json);
+
+    // Replaces the scripts with the ones in json, returns false when it is not a project.
+    bool Load(std::string_view json);
+
+    const std::string& GetName() const { return mName; }
+    const std::deque<Script>& GetScripts() const { return mScripts; }
+
+    // Scripts converted out of a project are numbered after it: Project-1.pdf, Project-2.pdf.
+    // Both paths are without their extension.
+    static std::string GetScriptPathBase(const std::string& projectPathBase, std::size_t script);
+
+private:
+    std::string mName;
+    std::deque<Script> mScripts; // Documents never move once loaded.
+};
@@ -0,0 +1,441 @@
+#include <algorithm>
+
+#include "StoryGraphAnalysis.h"
+
+StoryGraphAnalysis::StoryGraphAnalysis(const StoryGraph* graph)
+    : mGraph(graph)
+{
+    mLoopOffsets.push_back(0);
+}
+
+void StoryGraphAnalysis::SetGraph(const StoryGraph* graph)
+{
+    mGraph = graph;
+    mFullDirty = true;
+    mAdjacencyOffsets.clear();
+}
+
+void StoryGraphAnalysis::SetStartNode(int node)
+{
+    if (node == mStartNode) return;
+    mStartNode = node;
+    mDistancesDirty = true;
+}
+
+void StoryGraphAnalysis::Invalidate()
+{
+    mFullDirty = true;
+    mAdjacencyOffsets.clear();
+}
+
+example::Span<const int> StoryGraphAnalysis::GetLoop(std::size_t loop) const
+{
+    const int* nodes = mLoopNodes.data();
+    return example::Span<const int>(nodes + mLoopOffsets[loop], nodes + mLoopOffsets[loop + 1]);
+}
+
+int StoryGraphAnalysis::GetDistance(int node) const
+{
+    if (!mGraph || !mGraph->contains_node(node)) return -1;
+    return mDistances[StoryGraph::node_slot(node)];
+}
+
+bool StoryGraphAnalysis::IsOption(int node) const
+{
+    return mGraph->node(node).GetType() == NodeType::Option;
+}
+
+void StoryGraphAnalysis::Resize()
+{
+    auto slots = mGraph->node_slot_count();
+    if (mDistances.size() >= slots) return;
+
+    mDistances.resize(slots, -1);
+    mComponents.resize(slots, kNoComponent);
+    mOutDegrees.resize(slots, 0);
+    mOptions.resize(slots, 0);
+}
+
+void StoryGraphAnalysis::Update()
+{
+    if (!mGraph) return;
+    mLastUpdateFull = false;
+
+    if (mFullDirty || !mGraph->changes_since(mVersion, mChanges))
+    {
+        mVersion = mGraph->version();
+        AnalyzeAll();
+        mLastUpdateFull = true;
+        return;
+    }
+
+    mVersion = mGraph->version();
+    if (mChanges.empty() && !mDistancesDirty) return;
+
+    Resize();
+
+    auto componentsDirty = false;
+    for (const auto& change : mChanges)
+    {
+        switch (change.kind)
+        {
+        case example::GraphChange::InsertNode:
+        {
+            // A new node is its own component, numbering it last keeps the order valid.
+            auto slot = StoryGraph::node_slot(change.id);
+            mDistances[slot] = -1;
+            mComponents[slot] = mComponentCount++;
+            mOutDegrees[slot] = 0;
+            mOptions[slot] = mGraph->contains_node(change.id) && IsOption(change.id);
+            mNodeCount++;
+            mUnreachableCount++;
+            mDeadEndCount += mOptions[slot];
+            break;
+        }
+        case example::GraphChange::EraseNode:
+        {
+            // Its links were erased first, a reachable node may still have led elsewhere.
+            auto slot = StoryGraph::node_slot(change.id);
+            if (mDistances[slot] != -1)
+                mDistancesDirty = true;
+            else
+                mUnreachableCount--;
+            mDeadEndCount -= mOptions[slot] && mOutDegrees[slot] == 0;
+            mNodeCount--;
+            mDistances[slot] = -1;
+            mComponents[slot] = kNoComponent;
+            mOptions[slot] = 0;
+            break;
+        }
+        case example::GraphChange::InsertEdge:
+        {
+            auto from = StoryGraph::node_slot(change.from);
+            auto to = StoryGraph::node_slot(change.to);
+            mDeadEndCount -= mOptions[from] && mOutDegrees[from] == 0;
+            mOutDegrees[from]++;
+
+            // A link down the topological order of the components cannot close a loop.
+            if (change.from == change.to || mComponents[from] < mComponents[to])
+                componentsDirty = true;
+            break;
+        }
+        case example::GraphChange::EraseEdge:
+        {
+            auto from = StoryGraph::node_slot(change.from);
+            auto to = StoryGraph::node_slot(change.to);
+            mOutDegrees[from]--;
+            mDeadEndCount += mOptions[from] && mOutDegrees[from] == 0;
+
+            // Only a link inside a loop can break it. Distances only depended on the link if
+            // it was on a shortest path.
+            if (mComponents[from] == mComponents[to])
+                componentsDirty = true;
+            if (mDistances[from] != -1 && mDistances[to] == mDistances[from] + 1)
+                mDistancesDirty = true;
+            break;
+        }
+        }
+    }
+
+    if (componentsDirty)
+        FindComponents();
+
+    if (mDistancesDirty)
+    {
+        FindDistances();
+    }
+    else
+    {
+        // Links only ever shorten distances, start from the links that are still there.
+        for (const auto& change : mChanges)
+        {
+            if (change.kind != example::GraphChange::InsertEdge || !mGraph->contains_edge(change.id))
+                continue;
+
+            auto fromDistance = mDistances[StoryGraph::node_slot(change.from)];
+            if (fromDistance != -1)
+                Reach(change.to, fromDistance + 1);
+        }
+    }
+
+    mListsDirty = true;
+    mPathsDirty = true;
+}
+
+void StoryGraphAnalysis::AnalyzeAll()
+{
+    mDistances.clear();
+    mComponents.clear();
+    mOutDegrees.clear();
+    mOptions.clear();
+    Resize();
+
+    BuildAdjacency();
+    auto nodes = mGraph->nodes();
+    mNodeCount = nodes.size();
+    mDeadEndCount = 0;
+    for (auto node : nodes)
+    {
+        auto slot = StoryGraph::node_slot(node);
+        mOutDegrees[slot] = mAdjacencyOffsets[slot + 1] - mAdjacencyOffsets[slot];
+        mOptions[slot] = IsOption(node);
+        mDeadEndCount += mOptions[slot] && mOutDegrees[slot] == 0;
+    }
+
+    FindComponents();
+    FindDistances();
+
+    mFullDirty = false;
+    mListsDirty = true;
+    mPathsDirty = true;
+}
+
+// Tarjan's algorithm without recursion, graphs with long chains of scenes would overflow the
+// stack. Components complete sinks first, so every link runs from a higher numbered component
+// to a lower or the same one.
+void StoryGraphAnalysis::FindComponents()
+{
+    constexpr uint32_t kUnvisited = UINT32_MAX;
+    BuildAdjacency();
+    auto slots = mGraph->node_slot_count();
+    mIndices.assign(slots, kUnvisited);
+    mLowLinks.assign(slots, 0);
+    std::fill(mComponents.begin(), mComponents.end(), kNoComponent);
+    mComponentCount = 0;
+    mStack.clear();
+
+    uint32_t index = 0;
+    for (auto root : mGraph->nodes())
+    {
+        if (mIndices[StoryGraph::node_slot(root)] != kUnvisited) continue;
+
+        auto rootSlot = StoryGraph::node_slot(root);
+        mIndices[rootSlot] = mLowLinks[rootSlot] = index++;
+        mStack.push_back(root);
+        mCallStack.assign(1, {root, mAdjacencyOffsets[rootSlot]});
+
+        while (!mCallStack.empty())
+        {
+            auto& [node, next] = mCallStack.back();
+            auto slot = StoryGraph::node_slot(node);
+
+            if (next < mAdjacencyOffsets[slot + 1])
+            {
+                auto neighbor = mAdjacency[next++];
+                auto neighborSlot = StoryGraph::node_slot(neighbor);
+                if (mIndices[neighborSlot] == kUnvisited)
+                {
+                    mIndices[neighborSlot] = mLowLinks[neighborSlot] = index++;
+                    mStack.push_back(neighbor);
+                    mCallStack.push_back({neighbor, mAdjacencyOffsets[neighborSlot]});
+                }
+                else if (mComponents[neighborSlot] == kNoComponent)
+                {
+                    // Still on the stack, part of the component being built.
+                    mLowLinks[slot] = std::min(mLowLinks[slot], mIndices[neighborSlot]);
+                }
+                continue;
+            }
+
+            if (mLowLinks[slot] == mIndices[slot])
+            {
+                int member;
+                do
+                {
+                    member = mStack.back();
+                    mStack.pop_back();
+                    mComponents[StoryGraph::node_slot(member)] = mComponentCount;
+                } while (member != node);
+                mComponentCount++;
+            }
+
+            auto lowLink = mLowLinks[slot];
+            mCallStack.pop_back();
+            if (!mCallStack.empty())
+            {
+                auto parentSlot = StoryGraph::node_slot(mCallStack.back().first);
+                mLowLinks[parentSlot] = std::min(mLowLinks[parentSlot], lowLink);
+            }
+        }
+    }
+
+    // Loops are the components of more than one node and single nodes linking to themselves.
+    GroupComponents();
+    mLoopNodes.clear();
+    mLoopOffsets.assign(1, 0);
+    for (uint32_t component = 0; component < mComponentCount; component++)
+    {
+        auto first = mComponentOffsets[component];
+        auto count = mComponentOffsets[component + 1] - first;
+        if (count == 1)
+        {
+            auto node = mComponentNodes[first];
+            auto links = Links(node);
+            if (std::find(links.begin(), links.end(), node) == links.end())
+                continue;
+        }
+
+        mLoopNodes.insert(mLoopNodes.end(), mComponentNodes.begin() + first, mComponentNodes.begin() + first + count);
+        mLoopOffsets.push_back(mLoopNodes.size());
+    }
+}
+
+// The whole graph passes walk a flat copy of the links, built from the graph's densely stored
+// edges, rather than looking up every node's own lists.
+void StoryGraphAnalysis::BuildAdjacency()
+{
+    if (mAdjacencyVersion == mGraph->version() && !mAdjacencyOffsets.empty()) return;
+    mAdjacencyVersion = mGraph->version();
+
+    auto edges = mGraph->edges();
+    mAdjacencyOffsets.assign(mGraph->node_slot_count() + 1, 0);
+    for (const auto& edge : edges)
+        mAdjacencyOffsets[StoryGraph::node_slot(edge.from) + 1]++;
+    for (std::size_t slot = 0; slot + 1 < mAdjacencyOffsets.size(); slot++)
+        mAdjacencyOffsets[slot + 1] += mAdjacencyOffsets[slot];
+
+    mAdjacency.resize(edges.size());
+    mLowLinks.assign(mAdjacencyOffsets.begin(), mAdjacencyOffsets.end() - 1); // Fill positions.
+    for (const auto& edge : edges)
+        mAdjacency[mLowLinks[StoryGraph::node_slot(edge.from)]++] = edge.to;
+}
+
+// Links out of node, from the flat copy while it is current.
+example::Span<const int> StoryGraphAnalysis::Links(int node) const
+{
+    if (mAdjacencyVersion != mGraph->version() || mAdjacencyOffsets.empty())
+        return mGraph->neighbors(node);
+    auto slot = StoryGraph::node_slot(node);
+    return {mAdjacency.data() + mAdjacencyOffsets[slot], mAdjacency.data() + mAdjacencyOffsets[slot + 1]};
+}
+
+// Counting sort of the nodes by component.
+void StoryGraphAnalysis::GroupComponents()
+{
+    mComponentOffsets.assign(mComponentCount + 1, 0);
+    for (auto node : mGraph->nodes())
+        mComponentOffsets[mComponents[StoryGraph::node_slot(node)] + 1]++;
+    for (uint32_t component = 0; component < mComponentCount; component++)
+        mComponentOffsets[component + 1] += mComponentOffsets[component];
+
+    mComponentNodes.resize(mGraph->nodes().size());
+    mIndices.assign(mComponentOffsets.begin(), mComponentOffsets.end() - 1); // Fill positions.
+    for (auto node : mGraph->nodes())
+        mComponentNodes[mIndices[mComponents[StoryGraph::node_slot(node)]]++] = node;
+}
+
+void StoryGraphAnalysis::FindDistances()
+{
+    std::fill(mDistances.begin(), mDistances.end(), -1);
+    mUnreachableCount = mNodeCount;
+    BuildAdjacency();
+    if (mGraph->contains_node(mStartNode))
+        Reach(mStartNode, 0);
+    mDistancesDirty = false;
+}
+
+// Breadth first from node, lowering distances until they no longer improve.
+void StoryGraphAnalysis::Reach(int node, int distance)
+{
+    auto& nodeDistance = mDistances[StoryGraph::node_slot(node)];
+    if (nodeDistance != -1 && nodeDistance <= distance) return;
+    mUnreachableCount -= nodeDistance == -1;
+    nodeDistance = distance;
+
+    mQueue.assign(1, node);
+    for (std::size_t head = 0; head < mQueue.size(); head++)
+    {
+        auto next = mDistances[StoryGraph::node_slot(mQueue[head])] + 1;
+        for (auto neighbor : Links(mQueue[head]))
+        {
+            auto& neighborDistance = mDistances[StoryGraph::node_slot(neighbor)];
+            if (neighborDistance != -1 && neighborDistance <= next) continue;
+
+            mUnreachableCount -= neighborDistance == -1;
+            neighborDistance = next;
+            mQueue.push_back(neighbor);
+        }
+    }
+}
+
+const std::vector<int>& StoryGraphAnalysis::GetUnreachableNodes()
+{
+    if (mListsDirty && mGraph)
+    {
+        mUnreachableNodes.clear();
+        mDeadEndOptions.clear();
+        for (auto node : mGraph->nodes())
+        {
+            auto slot = StoryGraph::node_slot(node);
+            if (mDistances[slot] == -1)
+                mUnreachableNodes.push_back(node);
+            if (mOptions[slot] && mOutDegrees[slot] == 0)
+                mDeadEndOptions.push_back(node);
+        }
+        mListsDirty = false;
+    }
+
+    return mUnreachableNodes;
+}
+
+const std::vector<int>& StoryGraphAnalysis::GetDeadEndOptions()
+{
+    GetUnreachableNodes();
+    return mDeadEndOptions;
+}
+
+int StoryGraphAnalysis::GetShortestEnding()
+{
+    if (mPathsDirty && mGraph)
+        FindPathLengths();
+    return mShortestEnding;
+}
+
+int StoryGraphAnalysis::GetLongestEnding()
+{
+    if (mPathsDirty && mGraph)
+        FindPathLengths();
+    return mLongestEnding;
+}
+
+// Longest paths over the components in topological order, each loop is one step.
+void StoryGraphAnalysis::FindPathLengths()
+{
+    mPathsDirty = false;
+    mShortestEnding = -1;
+    mLongestEnding = -1;
+    if (!mGraph->contains_node(mStartNode)) return;
+
+    // Nodes added since the last FindComponents have components of their own, group again.
+    BuildAdjacency();
+    GroupComponents();
+
+    mLongest.assign(mComponentCount, -1);
+    mLongest[mComponents[StoryGraph::node_slot(mStartNode)]] = 0;
+    for (auto component = mComponentCount; component-- > 0;)
+    {
+        auto length = mLongest[component];
+        if (length < 0) continue;
+
+        for (auto i = mComponentOffsets[component]; i < mComponentOffsets[component + 1]; i++)
+        {
+            auto slot = StoryGraph::node_slot(mComponentNodes[i]);
+            for (auto edge = mAdjacencyOffsets[slot]; edge < mAdjacencyOffsets[slot + 1]; edge++)
+            {
+                auto target = mComponents[StoryGraph::node_slot(mAdjacency[edge])];
+                if (target != component)
+                    mLongest[target] = std::max(mLongest[target], length + 1);
+            }
+        }
+    }
+
+    for (auto node : mGraph->nodes())
+    {
+        auto slot = StoryGraph::node_slot(node);
+        if (mDistances[slot] == -1 || mOutDegrees[slot] != 0 || mOptions[slot]) continue;
+
+        if (mShortestEnding == -1 || mDistances[slot] < mShortestEnding)
+            mShortestEnding = mDistances[slot];
+        mLongestEnding = std::max(mLongestEnding, mLongest[mComponents[slot]]);
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "graph.h"
+#include "node.hpp"
+
+using StoryGraph = example::Graph<Node>;
+
+// The shape of a story graph as seen from its start node: nodes no playthrough reaches,
+// options that lead nowhere, loops, and how long the shortest and longest ways to an ending
+// are. Everything is computed in time linear in the size of the graph.
+//
+// Update follows the graph's change journal. Added links extend reachability and shortest
+// distances from the link alone. Loops are recomputed only when a link could close one (it
+// runs against the current topological order of the loops) or break one (it lies inside a
+// loop). Distances are recomputed only when a removed link was on a shortest path. Lists
+// and path lengths are derived on request and kept until the next change.
+class StoryGraphAnalysis {
+public:
+    explicit StoryGraphAnalysis(const StoryGraph* graph = nullptr);
+    ~StoryGraphAnalysis() = default;
+
+    void SetGraph(const StoryGraph* graph);
+    void SetStartNode(int node);
+    int GetStartNode() const { return mStartNode; }
+    void Invalidate(); // After edits the graph does not record, like changing a node's type.
+    void Update();
+
+    std::size_t GetNodeCount() const { return mNodeCount; }
+    std::size_t GetUnreachableCount() const { return mUnreachableCount; }
+    std::size_t GetDeadEndCount() const { return mDeadEndCount; } // Options without links out.
+    std::size_t GetLoopCount() const { return mLoopOffsets.size() - 1; }
+    example::Span<const int> GetLoop(std::size_t loop) const; // Node ids.
+
+    const std::vector<int>& GetUnreachableNodes();
+    const std::vector<int>& GetDeadEndOptions();
+
+    // Links from the start node, -1 when unreachable.
+    int GetDistance(int node) const;
+    // Endings are scenes without links out. Both are -1 when no ending is reachable. The
+    // longest way counts every loop as a single step so it is finite.
+    int GetShortestEnding();
+    int GetLongestEnding();
+
+    // Whether the last Update had to analyze the whole graph, for measuring.
+    bool WasLastUpdateFull() const { return mLastUpdateFull; }
+
+private:
+    static constexpr uint32_t kNoComponent = UINT32_MAX;
+
+    void Resize();
+    void AnalyzeAll();
+    void BuildAdjacency();
+    example::Span<const int> Links(int node) const;
+    void FindComponents();
+    void GroupComponents();
+    void FindDistances();
+    void Reach(int node, int distance);
+    void FindPathLengths();
+    bool IsOption(int node) const;
+
+    const StoryGraph* mGraph;
+    int mStartNode = -1;
+    uint64_t mVersion = 0;
+    bool mFullDirty = true;
+    bool mDistancesDirty = false;
+    bool mListsDirty = true;
+    bool mPathsDirty = true;
+    bool mLastUpdateFull = false;
+
+    // Indexed by node slot.
+    std::vector<int> mDistances;
+    std::vector<uint32_t> mComponents; // Links only run from higher to lower components.
+    std::vector<uint32_t> mOutDegrees;
+    std::vector<uint8_t> mOptions;
+
+    std::size_t mNodeCount = 0;
+    std::size_t mUnreachableCount = 0;
+    std::size_t mDeadEndCount = 0;
+    uint32_t mComponentCount = 0;
+
+    // Nodes of each loop, loop i is mLoopNodes[mLoopOffsets[i], mLoopOffsets[i + 1]).
+    std::vector<int> mLoopNodes;
+    std::vector<std::size_t> mLoopOffsets;
+
+    std::vector<int> mUnreachableNodes;
+    std::vector<int> mDeadEndOptions;
+    int mShortestEnding = -1;
+    int mLongestEnding = -1;
+
+    // Links by source slot, mAdjacency[mAdjacencyOffsets[slot], mAdjacencyOffsets[slot + 1]).
+    std::vector<uint32_t> mAdjacencyOffsets;
+    std::vector<int> mAdjacency;
+    uint64_t mAdjacencyVersion = 0;
+
+    // Scratch, kept to avoid allocating on every update.
+    std::vector<example::GraphChange> mChanges;
+    std::vector<int> mQueue;
+    std::vector<uint32_t> mIndices;
+    std::vector<uint32_t> mLowLinks;
+    std::vector<int> mStack;
+    std::vector<std::pair<int, uint32_t>> mCallStack;
+    std::vector<uint32_t> mComponentOffsets;
+    std::vector<int> mComponentNodes;
+    std::vector<int> mLongest;
+};
@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include <Poco/Environment.h>
+#include <Poco/Runnable.h>
+#include <Poco/ThreadPool.h>
+
+#include "StoryRuntime.h"
+
+namespace {
+
+constexpr uint64_t kChunk = 4096;
+constexpr uint64_t kPathHashBasis = 0xCBF29CE484222325ull; // FNV-1a
+constexpr uint64_t kPathHashPrime = 0x100000001B3ull;
+
+uint64_t Mix(uint64_t z)
+{
+    // splitmix64
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+class StoryJob : public Poco::Runnable {
+public:
+    explicit StoryJob(std::function<void()> work) : mWork(std::move(work)) {}
+    void run() override { mWork(); }
+
+private:
+    std::function<void()> mWork;
+};
+
+// Runs work(job) for every job, on the calling thread when there is only one.
+void RunJobs(int jobs, const std::function<void(int)>& work)
+{
+    if (jobs == 1)
+    {
+        work(0);
+        return;
+    }
+
+    Poco::ThreadPool pool(jobs, jobs);
+    std::vector<std::unique_ptr<StoryJob>> running;
+    for (int job = 0; job < jobs; job++)
+    {
+        running.push_back(std::make_unique<StoryJob>([&work, job] { work(job); }));
+        pool.start(*running.back());
+    }
+    pool.joinAll();
+}
+
+int GetJobs(const StoryRunSettings& settings)
+{
+    return settings.jobs > 0 ? settings.jobs : std::max(1, static_cast<int>(Poco::Environment::processorCount()));
+}
+
+} // namespace
+
+struct StoryRuntime::Counts {
+    uint64_t playthroughs = 0;
+    uint64_t finished = 0;
+    uint64_t totalLength = 0;
+    uint32_t shortest = UINT32_MAX;
+    uint32_t longest = 0;
+    std::vector<uint64_t> links;
+    std::vector<uint64_t> paths; // Hashes of the choices made, see PlayRandomRange.
+    std::size_t compactAt = 1 << 16;
+    bool cutShort = false; // PlayAll left paths out after reaching maxPaths.
+
+    void Finish(uint32_t length)
+    {
+        finished++;
+        totalLength += length;
+        shortest = std::min(shortest, length);
+        longest = std::max(longest, length);
+    }
+};
+
+double StoryReport::GetAverageLength() const
+{
+    return finished ? static_cast<double>(totalLength) / static_cast<double>(finished) : 0.0;
+}
+
+double StoryReport::GetNodeCoverage() const
+{
+    if (nodeVisits.empty()) return 0.0;
+    auto visited = nodeVisits.size() - std::count(nodeVisits.begin(), nodeVisits.end(), 0);
+    return static_cast<double>(visited) / static_cast<double>(nodeVisits.size());
+}
+
+double StoryReport::GetLinkCoverage() const
+{
+    if (linkCounts.empty()) return 0.0;
+    auto taken = linkCounts.size() - std::count(linkCounts.begin(), linkCounts.end(), 0);
+    return static_cast<double>(taken) / static_cast<double>(linkCounts.size());
+}
+
+bool StoryRuntime::Compile(const StoryGraph& graph, int startNode)
+{
+    mNodeIds.clear();
+    mNodeTypes.clear();
+    mLinkOffsets.clear();
+    mLinkTargets.clear();
+    if (!graph.contains_node(startNode)) return false;
+
+    // Group the links by the slot of the node they leave from, reading the graph's densely
+    // stored edges rather than every node's own lists.
+    auto edges = graph.edges();
+    std::vector<uint32_t> slotOffsets(graph.node_slot_count() + 1, 0);
+    for (const auto& edge : edges)
+        slotOffsets[StoryGraph::node_slot(edge.from) + 1]++;
+    for (std::size_t slot = 0; slot + 1 < slotOffsets.size(); slot++)
+        slotOffsets[slot + 1] += slotOffsets[slot];
+
+    std::vector<int> slotTargets(edges.size());
+    std::vector<uint32_t> positions(slotOffsets.begin(), slotOffsets.end() - 1);
+    for (const auto& edge : edges)
+        slotTargets[positions[StoryGraph::node_slot(edge.from)]++] = edge.to;
+
+    // Number the nodes breadth first from the start so a playthrough stays in a small part of
+    // the arrays, then the ones no playthrough reaches.
+    constexpr uint32_t kUnnumbered = UINT32_MAX;
+    auto& numbers = positions;
+    std::fill(numbers.begin(), numbers.end(), kUnnumbered);
+    auto number = [&](int node) {
+        auto& slot = numbers[StoryGraph::node_slot(node)];
+        if (slot != kUnnumbered) return;
+        slot = static_cast<uint32_t>(mNodeIds.size());
+        mNodeIds.push_back(node);
+    };
+
+    number(startNode);
+    for (std::size_t head = 0; head < mNodeIds.size(); head++)
+    {
+        auto slot = StoryGraph::node_slot(mNodeIds[head]);
+        for (auto link = slotOffsets[slot]; link < slotOffsets[slot + 1]; link++)
+            number(slotTargets[link]);
+    }
+    for (auto node : graph.nodes())
+        number(node);
+
+    mNodeTypes.reserve(mNodeIds.size());
+    mLinkOffsets.reserve(mNodeIds.size() + 1);
+    mLinkTargets.reserve(edges.size());
+    for (auto node : mNodeIds)
+    {
+        auto slot = StoryGraph::node_slot(node);
+        mNodeTypes.push_back(graph.node(node).GetType());
+        mLinkOffsets.push_back(static_cast<uint32_t>(mLinkTargets.size()));
+        for (auto link = slotOffsets[slot]; link < slotOffsets[slot + 1]; link++)
+            mLinkTargets.push_back(numbers[StoryGraph::node_slot(slotTargets[link])]);
+    }
+    mLinkOffsets.push_back(static_cast<uint32_t>(mLinkTargets.size()));
+    return true;
+}
+
+// Playthrough i draws its choices from a generator seeded with seed and i alone, which keeps
+// the results the same however the range is split between jobs. Only choices are hashed into
+// the path, they are all that tells two playthroughs apart.
+void StoryRuntime::PlayRandomRange(uint64_t first, uint64_t last, uint64_t seed, uint32_t maxSteps, Counts& counts) const
+{
+    const uint32_t* offsets = mLinkOffsets.data();
+    const uint32_t* targets = mLinkTargets.data();
+    uint64_t* links = counts.links.data();
+
+    for (auto i = first; i < last; i++)
+    {
+        uint64_t state = Mix(seed + i * 0x9E3779B97F4A7C15ull);
+        uint64_t path = kPathHashBasis;
+        uint32_t node = 0;
+        uint32_t steps = 0;
+        for (; steps < maxSteps; steps++)
+        {
+            auto begin = offsets[node];
+            auto count = offsets[node + 1] - begin;
+            if (count == 0) break;
+
+            auto link = begin;
+            if (count > 1)
+            {
+                auto random = Mix(state += 0x9E3779B97F4A7C15ull) >> 32;
+                link += static_cast<uint32_t>((random * count) >> 32);
+                path = (path ^ link) * kPathHashPrime;
+            }
+            links[link]++;
+            node = targets[link];
+        }
+
+        counts.playthroughs++;
+        if (offsets[node] != offsets[node + 1]) continue;
+
+        counts.Finish(steps);
+        counts.paths.push_back(path);
+        if (counts.paths.size() >= counts.compactAt)
+        {
+            std::sort(counts.paths.begin(), counts.paths.end());
+            counts.paths.erase(std::unique(counts.paths.begin(), counts.paths.end()), counts.paths.end());
+            counts.compactAt = std::max(counts.compactAt, counts.paths.size() * 2);
+        }
+    }
+}
+
+StoryReport StoryRuntime::PlayRandom(uint64_t playthroughs, const StoryRunSettings& settings) const
+{
+    if (mNodeIds.empty()) return {};
+
+    auto jobs = static_cast<int>(std::min<uint64_t>(GetJobs(settings), (playthroughs + kChunk - 1) / kChunk));
+    jobs = std::max(jobs, 1);
+    std::vector<Counts> counts(jobs);
+    std::atomic<uint64_t> next{0};
+
+    RunJobs(jobs, [&](int job) {
+        auto& jobCounts = counts[job];
+        jobCounts.links.assign(mLinkTargets.size(), 0);
+        for (;;)
+        {
+            auto first = next.fetch_add(kChunk);
+            if (first >= playthroughs) break;
+            PlayRandomRange(first, std::min(first + kChunk, playthroughs), settings.seed, settings.maxSteps, jobCounts);
+        }
+    });
+
+    auto report = MakeReport(counts);
+    std::vector<uint64_t> paths;
+    for (auto& jobCounts : counts)
+        paths.insert(paths.end(), jobCounts.paths.begin(), jobCounts.paths.end());
+    std::sort(paths.begin(), paths.end());
+    report.distinctPaths = static_cast<uint64_t>(std::unique(paths.begin(), paths.end()) - paths.begin());
+    return report;
+}
+
+// Depth first from node, which the links in prefix lead to. Instead of counting every link
+// of every path, each link adds up the paths found below it once they are all done.
+void StoryRuntime::PlayPaths(uint32_t node, const std::vector<uint32_t>& prefix, const StoryRunSettings& settings, std::atomic<uint64_t>& paths, Counts& counts) const
+{
+    struct Frame {
+        uint32_t node;
+        uint32_t next;
+        uint32_t link;
+        uint64_t pathsBefore;
+    };
+    constexpr uint32_t kNoLink = UINT32_MAX;
+
+    const uint32_t* offsets = mLinkOffsets.data();
+    const uint32_t* targets = mLinkTargets.data();
+    auto depth = static_cast<uint32_t>(prefix.size());
+    auto pathsBefore = counts.playthroughs;
+    uint64_t unreported = 0;
+    bool stopped = paths.load(std::memory_order_relaxed) >= settings.maxPaths;
+
+    std::vector<Frame> stack;
+    stack.push_back({node, offsets[node], kNoLink, counts.playthroughs});
+    while (!stack.empty())
+    {
+        auto& frame = stack.back();
+        auto end = offsets[frame.node + 1];
+        auto ending = offsets[frame.node] == end;
+        auto leaf = ending || depth == settings.maxSteps;
+        if (stopped && (leaf || frame.next < end))
+        {
+            counts.cutShort = true;
+        }
+        else if (leaf)
+        {
+            counts.playthroughs++;
+            if (ending)
+                counts.Finish(depth);
+
+            if (++unreported == kChunk)
+            {
+                stopped = paths.fetch_add(unreported, std::memory_order_relaxed) + unreported >= settings.maxPaths;
+                unreported = 0;
+            }
+        }
+        else if (frame.next < end)
+        {
+            auto link = frame.next++;
+            stack.push_back({targets[link], offsets[targets[link]], link, counts.playthroughs});
+            depth++;
+            continue;
+        }
+
+        if (frame.link != kNoLink)
+        {
+            counts.links[frame.link] += counts.playthroughs - frame.pathsBefore;
+            depth--;
+        }
+        stack.pop_back();
+    }
+    paths.fetch_add(unreported, std::memory_order_relaxed);
+
+    for (auto link : prefix)
+        counts.links[link] += counts.playthroughs - pathsBefore;
+}
+
+StoryReport StoryRuntime::PlayAll(const StoryRunSettings& settings) const
+{
+    if (mNodeIds.empty()) return {};
+
+    // Split the paths between jobs by their first few links: expand the start node breadth
+    // first until there are a good number of prefixes to go down.
+    struct Prefix {
+        uint32_t node;
+        std::vector<uint32_t> links;
+    };
+    auto jobs = GetJobs(settings);
+    std::vector<Prefix> prefixes{{0, {}}};
+    for (bool expanded = jobs > 1; expanded && prefixes.size() < static_cast<std::size_t>(jobs) * 16;)
+    {
+        expanded = false;
+        std::vector<Prefix> next;
+        for (auto& prefix : prefixes)
+        {
+            auto begin = mLinkOffsets[prefix.node];
+            auto end = mLinkOffsets[prefix.node + 1];
+            if (begin == end || prefix.links.size() >= settings.maxSteps)
+            {
+                next.push_back(std::move(prefix));
+                continue;
+            }
+
+            for (auto link = begin; link < end; link++)
+            {
+                next.push_back({mLinkTargets[link], prefix.links});
+                next.back().links.push_back(link);
+            }
+            expanded = true;
+        }
+        prefixes = std::move(next);
+    }
+
+    jobs = static_cast<int>(std::min<std::size_t>(jobs, prefixes.size()));
+    std::vector<Counts> counts(jobs);
+    std::atomic<std::size_t> next{0};
+    std::atomic<uint64_t> paths{0};
+
+    RunJobs(jobs, [&](int job) {
+        auto& jobCounts = counts[job];
+        jobCounts.links.assign(mLinkTargets.size(), 0);
+        for (auto prefix = next++; prefix < prefixes.size(); prefix = next++)
+            PlayPaths(prefixes[prefix].node, prefixes[prefix].links, settings, paths, jobCounts);
+    });
+
+    auto report = MakeReport(counts);
+    report.distinctPaths = report.finished;
+    report.complete = std::none_of(counts.begin(), counts.end(), [](const Counts& jobCounts) { return jobCounts.cutShort; });
+    return report;
+}
+
+StoryReport StoryRuntime::MakeReport(const std::vector<Counts>& counts) const
+{
+    StoryReport report;
+    report.linkCounts.assign(mLinkTargets.size(), 0);
+    uint32_t shortest = UINT32_MAX;
+    for (const auto& jobCounts : counts)
+    {
+        report.playthroughs += jobCounts.playthroughs;
+        report.finished += jobCounts.finished;
+        report.totalLength += jobCounts.totalLength;
+        shortest = std::min(shortest, jobCounts.shortest);
+        report.longest = std::max(report.longest, jobCounts.longest);
+        for (std::size_t link = 0; link < report.linkCounts.size(); link++)
+            report.linkCounts[link] += jobCounts.links[link];
+    }
+    report.shortest = report.finished ? shortest : 0;
+
+    // Every visit but the first of each playthrough comes through a link.
+    report.nodeVisits.assign(mNodeIds.size(), 0);
+    report.nodeVisits[0] = report.playthroughs;
+    for (std::size_t link = 0; link < mLinkTargets.size(); link++)
+        report.nodeVisits[mLinkTargets[link]] += report.linkCounts[link];
+    return report;
+}
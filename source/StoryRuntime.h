@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "StoryGraphAnalysis.h"
+
+struct StoryRunSettings {
+    uint32_t maxSteps = 10000;    // Links followed before a playthrough is given up as stuck in a loop.
+    uint64_t maxPaths = 10000000; // PlayAll stops at about this many, checked every few thousand paths.
+    uint64_t seed = 1;
+    int jobs = 0;                 // Threads, 0 for one per core.
+};
+
+struct StoryReport {
+    uint64_t playthroughs = 0;
+    uint64_t finished = 0;      // Reached an ending, the others ran into maxSteps.
+    uint64_t distinctPaths = 0; // Different ways the finished playthroughs went.
+    uint64_t totalLength = 0;   // Links followed by the finished playthroughs.
+    uint32_t shortest = 0;
+    uint32_t longest = 0;
+    bool complete = false;      // PlayAll went down every path, none were left out for maxPaths.
+
+    // By compiled node and link, see StoryRuntime.
+    std::vector<uint64_t> nodeVisits;
+    std::vector<uint64_t> linkCounts;
+
+    double GetAverageLength() const;
+    double GetNodeCoverage() const; // Share of the nodes visited at least once.
+    double GetLinkCoverage() const;
+};
+
+// A story graph compiled for playing through it many times. Nodes are numbered from 0 in the
+// order they are reached from the start node, the unreachable ones last, and their links are
+// stored together: node n links through mLinkTargets[mLinkOffsets[n], mLinkOffsets[n + 1]).
+// Node contents stay in the graph and are referred to by id.
+//
+// A playthrough starts at the start node and follows one link out of every node until it
+// reaches an ending, a node without links out. Where a node has several links, to options or
+// straight to other scenes, the player picks one.
+class StoryRuntime {
+public:
+    bool Compile(const StoryGraph& graph, int startNode);
+
+    std::size_t GetNodeCount() const { return mNodeIds.size(); }
+    std::size_t GetLinkCount() const { return mLinkTargets.size(); }
+    int GetNodeId(uint32_t node) const { return mNodeIds[node]; }
+    NodeType GetNodeType(uint32_t node) const { return mNodeTypes[node]; }
+    uint32_t GetLinksBegin(uint32_t node) const { return mLinkOffsets[node]; }
+    uint32_t GetLinksEnd(uint32_t node) const { return mLinkOffsets[node + 1]; }
+    uint32_t GetLinkTarget(uint32_t link) const { return mLinkTargets[link]; }
+
+    // Picks uniformly among the links at every choice. The report depends on the seed only,
+    // not on the number of jobs.
+    StoryReport PlayRandom(uint64_t playthroughs, const StoryRunSettings& settings = {}) const;
+    // Goes down every path from the start node, each at most maxSteps links long.
+    StoryReport PlayAll(const StoryRunSettings& settings = {}) const;
+
+private:
+    struct Counts;
+
+    void PlayRandomRange(uint64_t first, uint64_t last, uint64_t seed, uint32_t maxSteps, Counts& counts) const;
+    void PlayPaths(uint32_t node, const std::vector<uint32_t>& prefix, const StoryRunSettings& settings, std::atomic<uint64_t>& paths, Counts& counts) const;
+    StoryReport MakeReport(const std::vector<Counts>& counts) const;
+
+    std::vector<int> mNodeIds;
+    std::vector<NodeType> mNodeTypes;
+    std::vector<uint32_t> mLinkOffsets;
+    std::vector<uint32_t> mLinkTargets;
+};
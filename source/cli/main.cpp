@@ -0,0 +1,362 @@
+// scriptr-cli: validates and converts Scriptr documents and projects in bulk without a
+// window, a GL context or ImGui. Files are spread over one worker per core and the results
+// are reported in the order the files were given.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Poco/Environment.h>
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/Path.h>
+#include <Poco/RecursiveDirectoryIterator.h>
+#include <Poco/Runnable.h>
+#include <Poco/ThreadPool.h>
+
+#include "RichTextDocument.h"
+#include "ScriptPdfExporter.h"
+#include "ScriptProject.h"
+#include "script.hpp"
+
+enum class CliFormat {
+    eNone,
+    eJSON,
+    eHTML,
+    ePDF
+};
+
+struct CliOptions {
+    CliFormat format = CliFormat::eNone;
+    std::string outputDirectory;
+    int jobs = 0;
+    bool quiet = false;
+    std::vector<std::string> inputs;
+};
+
+struct CliResult {
+    bool ok = false;
+    std::size_t pages = 0;
+    std::string message;
+};
+
+static void PrintUsage()
+{
+    std::fprintf(stderr,
+        "usage: scriptr-cli [options] <file or directory>...\n"
+        "\n"
+        "Validates every document and project and reports its page count. Directories are\n"
+        "searched recursively for .json files. A project's scripts are converted to files\n"
+        "numbered after it, Project.json becomes Project-1.pdf, Project-2.pdf and so on.\n"
+        "\n"
+        "  --to json|html|pdf  also convert each document\n"
+        "  --out <directory>   write conversions there instead of next to the input, files\n"
+        "                      found in a directory keep their place below it\n"
+        "  --jobs <count>      worker threads, one per core by default\n"
+        "  --quiet             only report failures\n");
+}
+
+static const char* GetExtension(CliFormat format)
+{
+    switch (format)
+    {
+    case CliFormat::eJSON: return "json";
+    case CliFormat::eHTML: return "html";
+    case CliFormat::ePDF: return "pdf";
+    default: return "";
+    }
+}
+
+static bool ParseOptions(int argc, char** argv, CliOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        auto hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--to") == 0 && hasValue)
+        {
+            std::string format = argv[++i];
+            if (format == "json") options.format = CliFormat::eJSON;
+            else if (format == "html") options.format = CliFormat::eHTML;
+            else if (format == "pdf") options.format = CliFormat::ePDF;
+            else return false;
+        }
+        else if (std::strcmp(argv[i], "--out") == 0 && hasValue)
+            options.outputDirectory = argv[++i];
+        else if (std::strcmp(argv[i], "--jobs") == 0 && hasValue)
+            options.jobs = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--quiet") == 0)
+            options.quiet = true;
+        else if (argv[i][0] == '-')
+            return false;
+        else
+            options.inputs.push_back(argv[i]);
+    }
+
+    // Converting to JSON next to the input would overwrite it.
+    if (options.format == CliFormat::eJSON && options.outputDirectory.empty())
+        return false;
+
+    return !options.inputs.empty();
+}
+
+// One input file. Conversions are written to output with their extension added, conflict
+// names an earlier input that already writes there.
+struct CliFile {
+    std::string path;
+    std::string output;
+    std::string conflict;
+};
+
+// Every input's output base and the input that claimed it. Project scripts are written next
+// to their project with a number added, which must not land on another input's output either.
+typedef std::unordered_map<std::string, std::string> CliOutputs;
+
+// Where conversions of path go, without the extension. Under --out the directories between
+// the input root and the file are kept, so files of the same name stay apart.
+static std::string GetOutputBase(const Poco::Path& path, int rootDepth, const CliOptions& options)
+{
+    Poco::Path output(path);
+    if (!options.outputDirectory.empty())
+    {
+        output = Poco::Path(options.outputDirectory);
+        output.makeDirectory();
+        for (int i = rootDepth; i < path.depth(); i++)
+            output.pushDirectory(path.directory(i));
+    }
+
+    output.setFileName(path.getBaseName());
+    return output.toString();
+}
+
+// Expands directories into the documents inside them, sorted so runs are reproducible.
+static std::vector<CliFile> CollectFiles(const CliOptions& options)
+{
+    std::vector<CliFile> files;
+    for (const auto& input : options.inputs)
+    {
+        Poco::File file(input);
+        if (!file.exists() || !file.isDirectory())
+        {
+            Poco::Path path(input);
+            files.push_back(CliFile{input, GetOutputBase(path, path.depth(), options), {}});
+            continue;
+        }
+
+        Poco::Path root(input);
+        root.makeDirectory();
+
+        std::vector<CliFile> found;
+        Poco::SiblingsFirstRecursiveDirectoryIterator end;
+        for (Poco::SiblingsFirstRecursiveDirectoryIterator it(input); it != end; ++it)
+        {
+            if (it->isFile() && it.path().getExtension() == "json")
+                found.push_back(CliFile{it.path().toString(), GetOutputBase(it.path(), root.depth(), options), {}});
+        }
+
+        std::sort(found.begin(), found.end(), [](const CliFile& a, const CliFile& b) { return a.path < b.path; });
+        files.insert(files.end(), found.begin(), found.end());
+    }
+
+    return files;
+}
+
+// Converts one script to path, returns false when it could not be written.
+static bool WriteScript(const RichTextDocument& doc, const std::string& path, const CliOptions& options, ScriptPdfExporter& exporter)
+{
+    if (options.format == CliFormat::ePDF)
+        return exporter.Export(doc, path);
+
+    std::ofstream out(path, std::ios::binary);
+    if (options.format == CliFormat::eJSON)
+        doc.ExportToJSON(out);
+    else
+        doc.ExportToHTML(out);
+    return static_cast<bool>(out.flush());
+}
+
+static void ProcessFile(const CliFile& file, const CliOptions& options, const CliOutputs& outputs, ScriptPdfExporter& exporter, CliResult& result)
+{
+    auto converting = options.format != CliFormat::eNone;
+    if (converting && !file.conflict.empty())
+    {
+        result.message = "same output as " + file.conflict;
+        return;
+    }
+
+    std::ifstream stream(file.path, std::ios::binary);
+    if (!stream)
+    {
+        result.message = "cannot open";
+        return;
+    }
+    std::string json((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    // A document is converted on its own, a project's scripts one after another.
+    ScriptProject project;
+    RichTextDocument doc;
+    std::vector<const RichTextDocument*> scripts;
+    std::vector<std::string> outputBases;
+    auto type = ScriptProject::GetFileType(json);
+    if (type == ScriptFileType::eProject)
+    {
+        if (!project.Load(json))
+        {
+            result.message = "malformed project";
+            return;
+        }
+
+        for (const auto& script : project.GetScripts())
+        {
+            outputBases.push_back(ScriptProject::GetScriptPathBase(file.output, scripts.size()));
+            scripts.push_back(&script.doc);
+            auto claim = outputs.find(outputBases.back());
+            if (converting && claim != outputs.end())
+            {
+                result.message = "script " + std::to_string(scripts.size()) + " has the same output as " + claim->second;
+                return;
+            }
+        }
+    }
+    else if (type == ScriptFileType::eDocument && doc.ImportFromJSON(json))
+    {
+        scripts.push_back(&doc);
+        outputBases.push_back(file.output);
+    }
+    else
+    {
+        result.message = type == ScriptFileType::eDocument ? "malformed document" : "not a document or project";
+        return;
+    }
+
+    std::size_t paragraphs = 0;
+    for (auto script : scripts)
+    {
+        ScriptPaginator paginator(script);
+        paginator.Update();
+        result.pages += paginator.GetPageCount();
+        paragraphs += script->GetLineCount();
+    }
+    result.message = std::to_string(paragraphs) + " paragraphs, " + std::to_string(result.pages) + " pages";
+    if (type == ScriptFileType::eProject)
+        result.message += " in " + std::to_string(scripts.size()) + " scripts";
+
+    if (converting)
+    {
+        // A project's PDFs go through the exporter as one batch, anything else one by one.
+        auto batched = type == ScriptFileType::eProject && options.format == CliFormat::ePDF;
+        if (batched && exporter.ExportBatch(project, file.output) != scripts.size())
+        {
+            result.message = "cannot write every script";
+            return;
+        }
+
+        for (std::size_t i = 0; i < scripts.size(); i++)
+        {
+            auto output = outputBases[i] + "." + GetExtension(options.format);
+            if (!batched && !WriteScript(*scripts[i], output, options, exporter))
+            {
+                result.message = "cannot write " + output;
+                return;
+            }
+            result.message += (i == 0 ? " -> " : ", ") + output;
+        }
+    }
+
+    result.ok = true;
+}
+
+// Takes the next file until none are left. Every worker has its own exporter, documents
+// are already spread over the cores so each exports on a single thread.
+class CliWorker : public Poco::Runnable {
+public:
+    CliWorker(const CliOptions& options, const std::vector<CliFile>& files, const CliOutputs& outputs, std::vector<CliResult>& results, std::atomic<std::size_t>& next)
+        : mOptions(options), mFiles(files), mOutputs(outputs), mResults(results), mNext(next), mExporter(1)
+    {
+    }
+
+    void run() override
+    {
+        for (auto file = mNext++; file < mFiles.size(); file = mNext++)
+            ProcessFile(mFiles[file], mOptions, mOutputs, mExporter, mResults[file]);
+    }
+
+private:
+    const CliOptions& mOptions;
+    const std::vector<CliFile>& mFiles;
+    const CliOutputs& mOutputs;
+    std::vector<CliResult>& mResults;
+    std::atomic<std::size_t>& mNext;
+    ScriptPdfExporter mExporter;
+};
+
+int main(int argc, char** argv)
+{
+    CliOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Outputs are claimed up front in input order, so when two inputs would write to the
+    // same place it is always the later one that fails.
+    std::vector<CliFile> files;
+    CliOutputs outputs;
+    try
+    {
+        files = CollectFiles(options);
+        for (auto& file : files)
+        {
+            auto claim = outputs.emplace(file.output, file.path);
+            if (!claim.second)
+                file.conflict = claim.first->second;
+            else if (options.format != CliFormat::eNone)
+                Poco::File(Poco::Path(file.output).parent().toString()).createDirectories();
+        }
+    }
+    catch (const Poco::Exception& exception)
+    {
+        std::fprintf(stderr, "scriptr-cli: %s\n", exception.displayText().c_str());
+        return 1;
+    }
+
+    auto jobs = options.jobs > 0 ? options.jobs : static_cast<int>(Poco::Environment::processorCount());
+    jobs = std::max(1, std::min(jobs, static_cast<int>(files.size())));
+
+    std::vector<CliResult> results(files.size());
+    std::atomic<std::size_t> next{0};
+    std::vector<std::unique_ptr<CliWorker>> workers;
+    Poco::ThreadPool pool(jobs, jobs);
+    for (int i = 0; i < jobs; i++)
+    {
+        workers.push_back(std::make_unique<CliWorker>(options, files, outputs, results, next));
+        pool.start(*workers.back());
+    }
+    pool.joinAll();
+
+    std::size_t failed = 0;
+    std::size_t pages = 0;
+    for (std::size_t i = 0; i < files.size(); i++)
+    {
+        const auto& result = results[i];
+        failed += !result.ok;
+        pages += result.pages;
+        if (!result.ok || !options.quiet)
+            std::printf("%s %s: %s\n", result.ok ? "ok  " : "FAIL", files[i].path.c_str(), result.message.c_str());
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%zu files, %zu failed, %zu pages in %.2f s on %d threads\n", files.size(), failed, pages, seconds, jobs);
+    return failed > 0 ? 1 : 0;
+}
@@ -1,13 +1,17 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
 #include <iterator>
 #include <stack>
 #include <stddef.h>
 #include <utility>
 #include <vector>
 
+#include "ChangeJournal.h"
+
 namespace example
 {
 template<typename ElementType>
@@ -20,8 +24,12 @@ struct Span
     {
     }
 
+    Span(iterator b, iterator e) : begin_(b), end_(e) {}
+
     iterator begin() const { return begin_; }
     iterator end() const { return end_; }
+    size_t   size() const { return static_cast<size_t>(end_ - begin_); }
+    ElementType& operator[](size_t index) const { return begin_[index]; }
 
 private:
     iterator begin_;
@@ -164,17 +172,243 @@ bool IdMap<ElementType>::contains(const int id) const
     return *lower_bound == id;
 }
 
+// Generational slot map: insert, erase and lookup are O(1) and the elements stay densely
+// packed for iteration. Ids pack a slot index and the slot's generation, so an id stays valid
+// until its element is erased and is not mistaken for a later element reusing the slot
+// (generations wrap after 512 reuses of one slot).
+// Erasing moves the last element into the hole, iterators and references to elements are
+// invalidated by any insert or erase, ids are not.
+template<typename ElementType>
+class SlotMap
+{
+public:
+    using iterator = typename std::vector<ElementType>::iterator;
+    using const_iterator = typename std::vector<ElementType>::const_iterator;
+
+    static constexpr int invalid_id = -1;
+
+    // Iterators
+
+    iterator       begin() { return elements_.begin(); }
+    iterator       end() { return elements_.end(); }
+    const_iterator begin() const { return elements_.begin(); }
+    const_iterator end() const { return elements_.end(); }
+
+    // Element access
+
+    Span<const ElementType> elements() const { return elements_; }
+    // The id of each element, in the same order as elements().
+    Span<const int>         ids() const { return dense_ids_; }
+
+    // Capacity
+
+    bool   empty() const { return elements_.empty(); }
+    size_t size() const { return elements_.size(); }
+    void   reserve(size_t capacity);
+
+    // Live ids map to distinct slots below slot_count(), side tables can be indexed by slot.
+    size_t        slot_count() const { return slots_.size(); }
+    static size_t slot_of(int id) { return static_cast<uint32_t>(id) & index_mask_; }
+
+    // Modifiers
+
+    int    insert(const ElementType& element);
+    int    insert(ElementType&& element);
+    size_t erase(int id);
+    void   clear();
+
+    // Lookup
+
+    iterator       find(int id);
+    const_iterator find(int id) const;
+    bool           contains(int id) const;
+
+private:
+    static constexpr int      index_bits_ = 22;
+    static constexpr uint32_t index_mask_ = (1u << index_bits_) - 1;
+    static constexpr uint32_t generation_mask_ = 0x1FF; // Keeps ids positive.
+
+    struct Slot
+    {
+        uint32_t dense_index; // Next free slot while the slot is unused.
+        uint32_t generation;
+    };
+
+    int    allocate_slot();
+    size_t dense_index(int id) const;
+
+    std::vector<ElementType> elements_;
+    std::vector<int>         dense_ids_;
+    std::vector<Slot>        slots_;
+    uint32_t                 free_head_ = index_mask_;
+};
+
+template<typename ElementType>
+void SlotMap<ElementType>::reserve(const size_t capacity)
+{
+    elements_.reserve(capacity);
+    dense_ids_.reserve(capacity);
+    slots_.reserve(capacity);
+}
+
+template<typename ElementType>
+int SlotMap<ElementType>::allocate_slot()
+{
+    uint32_t index = free_head_;
+    if (index == index_mask_)
+    {
+        assert(slots_.size() < index_mask_);
+        index = static_cast<uint32_t>(slots_.size());
+        slots_.push_back(Slot{0, 0});
+    }
+    else
+    {
+        free_head_ = slots_[index].dense_index;
+    }
+
+    Slot& slot = slots_[index];
+    slot.dense_index = static_cast<uint32_t>(elements_.size());
+    const int id = static_cast<int>((slot.generation << index_bits_) | index);
+    dense_ids_.push_back(id);
+    return id;
+}
+
+template<typename ElementType>
+int SlotMap<ElementType>::insert(const ElementType& element)
+{
+    const int id = allocate_slot();
+    elements_.push_back(element);
+    return id;
+}
+
+template<typename ElementType>
+int SlotMap<ElementType>::insert(ElementType&& element)
+{
+    const int id = allocate_slot();
+    elements_.push_back(std::move(element));
+    return id;
+}
+
+template<typename ElementType>
+size_t SlotMap<ElementType>::erase(const int id)
+{
+    const size_t index = dense_index(id);
+    if (index == elements_.size())
+    {
+        return 0ull;
+    }
+
+    // Fill the hole with the last element so the elements stay contiguous.
+    const size_t last = elements_.size() - 1;
+    if (index != last)
+    {
+        elements_[index] = std::move(elements_[last]);
+        dense_ids_[index] = dense_ids_[last];
+        slots_[static_cast<uint32_t>(dense_ids_[index]) & index_mask_].dense_index =
+            static_cast<uint32_t>(index);
+    }
+    elements_.pop_back();
+    dense_ids_.pop_back();
+
+    const uint32_t slot_index = static_cast<uint32_t>(id) & index_mask_;
+    Slot&          slot = slots_[slot_index];
+    slot.generation = (slot.generation + 1) & generation_mask_;
+    slot.dense_index = free_head_;
+    free_head_ = slot_index;
+
+    return 1ull;
+}
+
+template<typename ElementType>
+void SlotMap<ElementType>::clear()
+{
+    // Every slot is retired so no id handed out before the clear finds a new element.
+    for (const int id : dense_ids_)
+    {
+        const uint32_t slot_index = static_cast<uint32_t>(id) & index_mask_;
+        Slot&          slot = slots_[slot_index];
+        slot.generation = (slot.generation + 1) & generation_mask_;
+        slot.dense_index = free_head_;
+        free_head_ = slot_index;
+    }
+
+    elements_.clear();
+    dense_ids_.clear();
+}
+
+template<typename ElementType>
+size_t SlotMap<ElementType>::dense_index(const int id) const
+{
+    if (id < 0)
+    {
+        return elements_.size();
+    }
+
+    const uint32_t slot_index = static_cast<uint32_t>(id) & index_mask_;
+    if (slot_index >= slots_.size())
+    {
+        return elements_.size();
+    }
+
+    // A free slot's dense_index links the free list, the id check below rejects it.
+    const Slot& slot = slots_[slot_index];
+    if (slot.dense_index >= elements_.size() || dense_ids_[slot.dense_index] != id)
+    {
+        return elements_.size();
+    }
+
+    return slot.dense_index;
+}
+
+template<typename ElementType>
+typename SlotMap<ElementType>::iterator SlotMap<ElementType>::find(const int id)
+{
+    return std::next(elements_.begin(), dense_index(id));
+}
+
+template<typename ElementType>
+typename SlotMap<ElementType>::const_iterator SlotMap<ElementType>::find(const int id) const
+{
+    return std::next(elements_.cbegin(), dense_index(id));
+}
+
+template<typename ElementType>
+bool SlotMap<ElementType>::contains(const int id) const
+{
+    return dense_index(id) != elements_.size();
+}
+
+// One edit of a Graph, see Graph::changes_since. Erasing a node records the erasure of each
+// of its edges before the node's own.
+struct GraphChange
+{
+    enum Kind
+    {
+        InsertNode,
+        EraseNode,
+        InsertEdge,
+        EraseEdge
+    };
+
+    Kind kind;
+    int  id;
+    int  from, to; // Edges only.
+};
+
 // a very simple directional graph
 template<typename NodeType>
 class Graph
 {
 public:
-    Graph() : current_id_(0), nodes_(), edges_from_node_(), node_neighbors_(), edges_() {}
+    Graph() : nodes_(), edges_(), changes_(max_recorded_changes_) {}
 
     struct Edge
     {
         int id;
         int from, to;
+        // Where the edge sits in the from node's outgoing and the to node's incoming edge
+        // lists, kept up to date by Graph so edges detach in O(1).
+        int out_index = 0, in_index = 0;
 
         Edge() = default;
         Edge(const int id, const int f, const int t) : id(id), from(f), to(t) {}
@@ -188,29 +422,62 @@ public:
     NodeType&        node(int node_id);
     const NodeType&  node(int node_id) const;
     Span<const int>  neighbors(int node_id) const;
+    Span<const int>  nodes() const; // Node ids.
+    Span<const int>  outgoing_edges(int node_id) const; // Edge ids, in the order of neighbors().
+    Span<const int>  incoming_edges(int node_id) const;
+    const Edge&      edge(int edge_id) const;
     Span<const Edge> edges() const;
 
+    // Lookup
+
+    bool contains_node(int node_id) const { return nodes_.contains(node_id); }
+    bool contains_edge(int edge_id) const { return edges_.contains(edge_id); }
+
     // Capacity
 
     size_t num_edges_from_node(int node_id) const;
+    // Node side tables can be indexed by slot, see SlotMap.
+    size_t        node_slot_count() const { return nodes_.slot_count(); }
+    static size_t node_slot(int node_id) { return SlotMap<NodeEntry>::slot_of(node_id); }
+
+    // Changes
+
+    // See ChangeJournal.
+    uint64_t version() const { return changes_.GetVersion(); }
+    bool     changes_since(uint64_t version, std::vector<GraphChange>& changes) const { return changes_.GetChangesSince(version, changes); }
 
     // Modifiers
 
     int  insert_node(const NodeType& node);
     void erase_node(int node_id);
+    // Erases the nodes and every edge touching them in O(sum of their degrees), edges
+    // between two of the erased nodes are only visited once.
+    void erase_nodes(Span<const int> node_ids);
 
     int  insert_edge(int from, int to);
     void erase_edge(int edge_id);
 
 private:
-    int current_id_;
-    // These contains map to the node id
-    IdMap<NodeType>         nodes_;
-    IdMap<int>              edges_from_node_;
-    IdMap<std::vector<int>> node_neighbors_;
-
-    // This container maps to the edge id
-    IdMap<Edge> edges_;
+    struct NodeEntry
+    {
+        NodeType         node;
+        std::vector<int> neighbors;
+        std::vector<int> out_edges;
+        std::vector<int> in_edges;
+        bool             erasing = false;
+    };
+
+    void detach_outgoing(const Edge& edge);
+    void detach_incoming(const Edge& edge);
+    void record(GraphChange::Kind kind, int id, int from = -1, int to = -1);
+
+    static constexpr size_t max_recorded_changes_ = 4096;
+
+    // Node and edge ids are handles into these, see SlotMap.
+    SlotMap<NodeEntry> nodes_;
+    SlotMap<Edge>      edges_;
+
+    ChangeJournal<GraphChange> changes_;
 };
 
 template<typename NodeType>
@@ -224,14 +491,44 @@ const NodeType& Graph<NodeType>::node(const int id) const
 {
     const auto iter = nodes_.find(id);
     assert(iter != nodes_.end());
-    return *iter;
+    return iter->node;
 }
 
 template<typename NodeType>
 Span<const int> Graph<NodeType>::neighbors(int node_id) const
 {
-    const auto iter = node_neighbors_.find(node_id);
-    assert(iter != node_neighbors_.end());
+    const auto iter = nodes_.find(node_id);
+    assert(iter != nodes_.end());
+    return iter->neighbors;
+}
+
+template<typename NodeType>
+Span<const int> Graph<NodeType>::nodes() const
+{
+    return nodes_.ids();
+}
+
+template<typename NodeType>
+Span<const int> Graph<NodeType>::outgoing_edges(int node_id) const
+{
+    const auto iter = nodes_.find(node_id);
+    assert(iter != nodes_.end());
+    return iter->out_edges;
+}
+
+template<typename NodeType>
+Span<const int> Graph<NodeType>::incoming_edges(int node_id) const
+{
+    const auto iter = nodes_.find(node_id);
+    assert(iter != nodes_.end());
+    return iter->in_edges;
+}
+
+template<typename NodeType>
+const typename Graph<NodeType>::Edge& Graph<NodeType>::edge(const int edge_id) const
+{
+    const auto iter = edges_.find(edge_id);
+    assert(iter != edges_.end());
     return *iter;
 }
 
@@ -244,100 +541,151 @@ Span<const typename Graph<NodeType>::Edge> Graph<NodeType>::edges() const
 template<typename NodeType>
 size_t Graph<NodeType>::num_edges_from_node(const int id) const
 {
-    auto iter = edges_from_node_.find(id);
-    assert(iter != edges_from_node_.end());
-    return *iter;
+    auto iter = nodes_.find(id);
+    assert(iter != nodes_.end());
+    return iter->neighbors.size();
+}
+
+template<typename NodeType>
+void Graph<NodeType>::record(const GraphChange::Kind kind, const int id, const int from, const int to)
+{
+    changes_.Record(GraphChange{kind, id, from, to});
 }
 
 template<typename NodeType>
 int Graph<NodeType>::insert_node(const NodeType& node)
 {
-    const int id = current_id_++;
-    assert(!nodes_.contains(id));
-    nodes_.insert(id, node);
-    edges_from_node_.insert(id, 0);
-    node_neighbors_.insert(id, std::vector<int>());
+    const int id = nodes_.insert(NodeEntry{node, {}, {}, {}, false});
+    record(GraphChange::InsertNode, id);
     return id;
 }
 
 template<typename NodeType>
 void Graph<NodeType>::erase_node(const int id)
 {
+    const std::array<int, 1> node_ids = {id};
+    erase_nodes(node_ids);
+}
 
-    // first, remove any potential dangling edges
+template<typename NodeType>
+void Graph<NodeType>::erase_nodes(const Span<const int> node_ids)
+{
+    for (const int id : node_ids)
     {
-        static std::vector<int> edges_to_erase;
+        assert(nodes_.contains(id));
+        nodes_.find(id)->erasing = true;
+    }
 
-        for (const Edge& edge : edges_.elements())
+    for (const int id : node_ids)
+    {
+        // A node listed twice has no edges left the second time round.
+        const auto entry = nodes_.find(id);
+
+        // Outgoing edges are erased here, incoming ones only when their source stays: an edge
+        // from another erased node is erased with that node's outgoing edges.
+        for (const int edge_id : entry->out_edges)
         {
-            if (edge.contains(id))
+            const Edge& edge = *edges_.find(edge_id);
+            if (edge.to != id && !nodes_.find(edge.to)->erasing)
             {
-                edges_to_erase.push_back(edge.id);
+                detach_incoming(edge);
             }
+            record(GraphChange::EraseEdge, edge_id, edge.from, edge.to);
+            edges_.erase(edge_id);
         }
 
-        for (const int edge_id : edges_to_erase)
+        for (const int edge_id : entry->in_edges)
         {
-            erase_edge(edge_id);
+            const auto edge = edges_.find(edge_id);
+            if (edge == edges_.end() || edge->from == id || nodes_.find(edge->from)->erasing)
+            {
+                continue;
+            }
+            detach_outgoing(*edge);
+            record(GraphChange::EraseEdge, edge_id, edge->from, edge->to);
+            edges_.erase(edge_id);
         }
 
-        edges_to_erase.clear();
+        entry->out_edges.clear();
+        entry->in_edges.clear();
     }
 
-    nodes_.erase(id);
-    edges_from_node_.erase(id);
-    node_neighbors_.erase(id);
+    for (const int id : node_ids)
+    {
+        if (nodes_.erase(id))
+        {
+            record(GraphChange::EraseNode, id);
+        }
+    }
 }
 
 template<typename NodeType>
 int Graph<NodeType>::insert_edge(const int from, const int to)
 {
-    const int id = current_id_++;
-    assert(!edges_.contains(id));
     assert(nodes_.contains(from));
     assert(nodes_.contains(to));
-    edges_.insert(id, Edge(id, from, to));
+    const int id = edges_.insert(Edge(SlotMap<Edge>::invalid_id, from, to));
+
+    auto& source = *nodes_.find(from);
+    auto& target = *nodes_.find(to);
+    Edge& edge = *edges_.find(id);
+    edge.id = id;
+    edge.out_index = static_cast<int>(source.out_edges.size());
+    edge.in_index = static_cast<int>(target.in_edges.size());
 
-    // update neighbor count
-    assert(edges_from_node_.contains(from));
-    *edges_from_node_.find(from) += 1;
-    // update neighbor list
-    assert(node_neighbors_.contains(from));
-    node_neighbors_.find(from)->push_back(to);
+    source.out_edges.push_back(id);
+    source.neighbors.push_back(to);
+    target.in_edges.push_back(id);
 
+    record(GraphChange::InsertEdge, id, from, to);
     return id;
 }
 
 template<typename NodeType>
 void Graph<NodeType>::erase_edge(const int edge_id)
 {
-    // This is a bit lazy, we find the pointer here, but we refind it when we erase the edge based
-    // on id key.
     assert(edges_.contains(edge_id));
     const Edge& edge = *edges_.find(edge_id);
 
-    // update neighbor count
-    assert(edges_from_node_.contains(edge.from));
-    int& edge_count = *edges_from_node_.find(edge.from);
-    assert(edge_count > 0);
-    edge_count -= 1;
+    detach_outgoing(edge);
+    detach_incoming(edge);
+    record(GraphChange::EraseEdge, edge_id, edge.from, edge.to);
+    edges_.erase(edge_id);
+}
 
-    // update neighbor list
-    {
-        assert(node_neighbors_.contains(edge.from));
-        auto neighbors = node_neighbors_.find(edge.from);
-        auto iter = std::find(neighbors->begin(), neighbors->end(), edge.to);
-        assert(iter != neighbors->end());
-        neighbors->erase(iter);
-    }
+// Both swap the last edge of the list into the edge's place and tell the moved edge.
+template<typename NodeType>
+void Graph<NodeType>::detach_outgoing(const Edge& edge)
+{
+    auto&     source = *nodes_.find(edge.from);
+    const int moved = source.out_edges.back();
+    assert(source.out_edges[edge.out_index] == edge.id);
+
+    source.out_edges[edge.out_index] = moved;
+    source.neighbors[edge.out_index] = source.neighbors.back();
+    source.out_edges.pop_back();
+    source.neighbors.pop_back();
+    edges_.find(moved)->out_index = edge.out_index;
+}
 
-    edges_.erase(edge_id);
+template<typename NodeType>
+void Graph<NodeType>::detach_incoming(const Edge& edge)
+{
+    auto&     target = *nodes_.find(edge.to);
+    const int moved = target.in_edges.back();
+    assert(target.in_edges[edge.in_index] == edge.id);
+
+    target.in_edges[edge.in_index] = moved;
+    target.in_edges.pop_back();
+    edges_.find(moved)->in_index = edge.in_index;
 }
 
+// Visits every node reachable from start_node once, cycles and shared nodes included.
 template<typename NodeType, typename Visitor>
 void dfs_traverse(const Graph<NodeType>& graph, const int start_node, Visitor visitor)
 {
-    std::stack<int> stack;
+    std::stack<int>   stack;
+    std::vector<bool> visited(graph.node_slot_count(), false);
 
     stack.push(start_node);
 
@@ -346,11 +694,20 @@ void dfs_traverse(const Graph<NodeType>& graph, const int start_node, Visitor vi
         const int current_node = stack.top();
         stack.pop();
 
+        if (visited[Graph<NodeType>::node_slot(current_node)])
+        {
+            continue;
+        }
+        visited[Graph<NodeType>::node_slot(current_node)] = true;
+
         visitor(current_node);
 
         for (const int neighbor : graph.neighbors(current_node))
         {
-            stack.push(neighbor);
+            if (!visited[Graph<NodeType>::node_slot(neighbor)])
+            {
+                stack.push(neighbor);
+            }
         }
     }
 }
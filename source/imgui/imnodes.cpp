@@ -1,5 +1,6 @@
 // the structure of this file:
 //
+// [SECTION] spatial grid
 // [SECTION] bezier curve helpers
 // [SECTION] draw list helper
 // [SECTION] ui state logic
@@ -29,6 +30,170 @@
 
 ImNodesContext* GImNodes = NULL;
 
+// [SECTION] spatial grid
+
+namespace
+{
+// Cells further out than this share the outermost cells, which keeps the keys unique.
+const int GRID_CELL_LIMIT = 32767;
+
+inline int GetGridCellCoordinate(const float v)
+{
+    const float cell = floorf(v / static_cast<float>(ImSpatialGrid::CELL_SIZE));
+    if (!(cell > -GRID_CELL_LIMIT))
+    {
+        return -GRID_CELL_LIMIT;
+    }
+    return cell < GRID_CELL_LIMIT ? static_cast<int>(cell) : GRID_CELL_LIMIT;
+}
+
+inline ImGuiID GetGridCellKey(const int x, const int y)
+{
+    return (static_cast<ImGuiID>(x & 0xffff) << 16) | static_cast<ImGuiID>(y & 0xffff);
+}
+
+int CompareIndices(const void* lhs, const void* rhs)
+{
+    return *static_cast<const int*>(lhs) - *static_cast<const int*>(rhs);
+}
+
+void AddUnmarkedIndices(
+    const ImVector<int>&    cell_indices,
+    const int               pool_size,
+    ImVector<unsigned int>& marks,
+    const unsigned int      mark,
+    ImVector<int>&          indices)
+{
+    for (int i = 0; i < cell_indices.Size; ++i)
+    {
+        const int idx = cell_indices[i];
+        if (idx < pool_size && marks[idx] != mark)
+        {
+            marks[idx] = mark;
+            indices.push_back(idx);
+        }
+    }
+}
+} // namespace
+
+ImGridCellRange ImSpatialGrid::GetCellRange(const ImRect& grid_rect) const
+{
+    if (!(grid_rect.Min.x <= grid_rect.Max.x && grid_rect.Min.y <= grid_rect.Max.y))
+    {
+        return ImGridCellRange();
+    }
+
+    return ImGridCellRange(
+        GetGridCellCoordinate(grid_rect.Min.x),
+        GetGridCellCoordinate(grid_rect.Min.y),
+        GetGridCellCoordinate(grid_rect.Max.x),
+        GetGridCellCoordinate(grid_rect.Max.y));
+}
+
+void ImSpatialGrid::Insert(const ImSpatialGridList list, const int idx, const ImGridCellRange& range)
+{
+    for (int y = range.MinY; y <= range.MaxY; ++y)
+    {
+        for (int x = range.MinX; x <= range.MaxX; ++x)
+        {
+            const ImGuiID key = GetGridCellKey(x, y);
+            int           cell_idx = CellMap.GetInt(key, -1);
+            if (cell_idx == -1)
+            {
+                // Cells are kept once created, the same areas tend to be populated again.
+                cell_idx = Cells.Size;
+                Cells.resize(Cells.Size + 1);
+                IM_PLACEMENT_NEW(Cells.Data + cell_idx) ImSpatialGridCell(x, y);
+                CellMap.SetInt(key, cell_idx);
+            }
+            Cells[cell_idx].Indices[list].push_back(idx);
+        }
+    }
+}
+
+void ImSpatialGrid::Remove(const ImSpatialGridList list, const int idx, const ImGridCellRange& range)
+{
+    for (int y = range.MinY; y <= range.MaxY; ++y)
+    {
+        for (int x = range.MinX; x <= range.MaxX; ++x)
+        {
+            const int cell_idx = CellMap.GetInt(GetGridCellKey(x, y), -1);
+            assert(cell_idx != -1);
+            Cells[cell_idx].Indices[list].find_erase_unsorted(idx);
+        }
+    }
+}
+
+void ImSpatialGrid::Move(
+    const ImSpatialGridList list,
+    const int               idx,
+    ImGridCellRange&        range,
+    const ImRect&           grid_rect)
+{
+    const ImGridCellRange new_range = GetCellRange(grid_rect);
+    if (new_range != range)
+    {
+        Remove(list, idx, range);
+        Insert(list, idx, new_range);
+        range = new_range;
+    }
+}
+
+void ImSpatialGrid::Query(
+    const ImSpatialGridList list,
+    const ImRect&           grid_rect,
+    const int               pool_size,
+    ImVector<int>&          indices) const
+{
+    indices.resize(0);
+
+    const ImGridCellRange range = GetCellRange(grid_rect);
+    if (range.IsEmpty())
+    {
+        return;
+    }
+
+    ImVector<unsigned int>& marks = Marks[list];
+    if (marks.Size < pool_size)
+    {
+        const int old_size = marks.Size;
+        marks.resize(pool_size);
+        memset(marks.Data + old_size, 0, (pool_size - old_size) * sizeof(unsigned int));
+    }
+
+    if (++QueryMark == 0)
+    {
+        memset(marks.Data, 0, marks.size_in_bytes());
+        QueryMark = 1;
+    }
+
+    // A large box selector can span more cells than there are, visit the existing ones then.
+    const bool visit_all_cells = range.GetCellCount() > Cells.Size;
+    for (int i = 0; visit_all_cells && i < Cells.Size; ++i)
+    {
+        const ImSpatialGridCell& cell = Cells[i];
+        if (range.Contains(cell.X, cell.Y))
+        {
+            AddUnmarkedIndices(cell.Indices[list], pool_size, marks, QueryMark, indices);
+        }
+    }
+
+    for (int y = range.MinY; !visit_all_cells && y <= range.MaxY; ++y)
+    {
+        for (int x = range.MinX; x <= range.MaxX; ++x)
+        {
+            const int cell_idx = CellMap.GetInt(GetGridCellKey(x, y), -1);
+            if (cell_idx != -1)
+            {
+                AddUnmarkedIndices(
+                    Cells[cell_idx].Indices[list], pool_size, marks, QueryMark, indices);
+            }
+        }
+    }
+
+    ImQsort(indices.Data, static_cast<size_t>(indices.Size), sizeof(int), CompareIndices);
+}
+
 namespace IMNODES_NAMESPACE
 {
 namespace
@@ -560,6 +725,154 @@ ImVec2 GetScreenSpacePinCoordinates(const ImNodesEditorContext& editor, const Im
     return GetScreenSpacePinCoordinates(parent_node_rect, pin.AttributeRect, pin.Type);
 }
 
+// The area a node covers in the spatial grid, widened to take in its pins.
+ImRect GetNodeGridRect(const ImNodesEditorContext& editor, const ImNodeData& node)
+{
+    ImRect rect = ScreenSpaceToGridSpace(editor, node.Rect);
+    rect.Expand(ImVec2(ImFabs(GImNodes->Style.PinOffset), 0.f));
+    return rect;
+}
+
+// Square of the given half size around a screen space position, in grid space.
+ImRect GetGridQueryRect(const ImNodesEditorContext& editor, const ImVec2& pos, const float radius)
+{
+    const ImVec2 grid_pos = ScreenSpaceToGridSpace(editor, pos);
+    return ImRect(grid_pos - ImVec2(radius, radius), grid_pos + ImVec2(radius, radius));
+}
+
+// Queues a link to be placed in the grid by the next SpatialGridUpdateLinks() call.
+void SpatialGridQueueLink(ImNodesEditorContext& editor, const int link_idx)
+{
+    ImLinkData& link = editor.Links.Pool[link_idx];
+    if (!link.NeedsPlacing)
+    {
+        link.NeedsPlacing = true;
+        editor.UnplacedLinkIndices.push_back(link_idx);
+    }
+}
+
+// Lists the link with its pins, so it is placed again whenever one of them moves.
+void SpatialGridAttachLink(ImNodesEditorContext& editor, const int link_idx)
+{
+    const ImLinkData& link = editor.Links.Pool[link_idx];
+    const int         pin_indices[2] = {link.StartPinIdx, link.EndPinIdx};
+    for (int i = 0; i < 2; ++i)
+    {
+        ImVector<int>& link_indices = editor.Pins.Pool[pin_indices[i]].LinkIndices;
+        if (!link_indices.contains(link_idx))
+        {
+            link_indices.push_back(link_idx);
+        }
+    }
+
+    SpatialGridQueueLink(editor, link_idx);
+}
+
+// Moves a pin in grid space. Its links are placed again only if it actually moved.
+void SpatialGridMovePin(ImNodesEditorContext& editor, const int pin_idx, const ImVec2& grid_pos)
+{
+    ImPinData& pin = editor.Pins.Pool[pin_idx];
+    if (pin.GridPos.x == grid_pos.x && pin.GridPos.y == grid_pos.y)
+    {
+        return;
+    }
+
+    pin.GridPos = grid_pos;
+    if (!pin.Moved)
+    {
+        pin.Moved = true;
+        editor.MovedPinIndices.push_back(pin_idx);
+    }
+}
+
+// Links are placed by the box containing their curve, which moves with either end. Only the links
+// that are new, were attached to other pins or have a pin that moved are placed again.
+void SpatialGridUpdateLinks(ImNodesEditorContext& editor)
+{
+    // The boxes grow with the hover distance, so changing it moves every link.
+    if (editor.LinkGridHoverDistance != GImNodes->Style.LinkHoverDistance)
+    {
+        editor.LinkGridHoverDistance = GImNodes->Style.LinkHoverDistance;
+        for (int link_idx = 0; link_idx < editor.Links.Pool.size(); ++link_idx)
+        {
+            if (editor.Links.InUse[link_idx])
+            {
+                SpatialGridQueueLink(editor, link_idx);
+            }
+        }
+    }
+
+    // Everything was submitted this frame, so unused pins and links are being removed.
+    for (int i = 0; i < editor.MovedPinIndices.size(); ++i)
+    {
+        const int  pin_idx = editor.MovedPinIndices[i];
+        ImPinData& pin = editor.Pins.Pool[pin_idx];
+        if (!editor.Pins.InUse[pin_idx] || !pin.Moved)
+        {
+            continue;
+        }
+        pin.Moved = false;
+
+        ImVector<int>& link_indices = pin.LinkIndices;
+        for (int j = 0; j < link_indices.size();)
+        {
+            const int         link_idx = link_indices[j];
+            const ImLinkData& link = editor.Links.Pool[link_idx];
+            if (editor.Links.InUse[link_idx] &&
+                (link.StartPinIdx == pin_idx || link.EndPinIdx == pin_idx))
+            {
+                SpatialGridQueueLink(editor, link_idx);
+                ++j;
+            }
+            else
+            {
+                // The link is gone or attached elsewhere, drop it from the pin.
+                link_indices.erase_unsorted(link_indices.Data + j);
+            }
+        }
+    }
+    editor.MovedPinIndices.clear();
+
+    for (int i = 0; i < editor.UnplacedLinkIndices.size(); ++i)
+    {
+        const int   link_idx = editor.UnplacedLinkIndices[i];
+        ImLinkData& link = editor.Links.Pool[link_idx];
+        if (!editor.Links.InUse[link_idx] || !link.NeedsPlacing)
+        {
+            continue;
+        }
+        link.NeedsPlacing = false;
+
+        const ImPinData&  start_pin = editor.Pins.Pool[link.StartPinIdx];
+        const ImPinData&  end_pin = editor.Pins.Pool[link.EndPinIdx];
+        const CubicBezier cubic_bezier = GetCubicBezier(
+            start_pin.GridPos,
+            end_pin.GridPos,
+            start_pin.Type,
+            GImNodes->Style.LinkLineSegmentsPerLength);
+
+        editor.Grid.Move(
+            ImSpatialGridList_Links,
+            link_idx,
+            link.GridCells,
+            GetContainingRectForCubicBezier(cubic_bezier));
+    }
+    editor.UnplacedLinkIndices.clear();
+}
+
+// Positions in the depth stack by node index, so comparing depths doesn't search the stack.
+void UpdateNodeDepthIndices(const ImNodesEditorContext& editor)
+{
+    const ImVector<int>& depth_stack = editor.NodeDepthOrder;
+    ImVector<int>&       depth_indices = GImNodes->NodeDepthIndices;
+
+    depth_indices.resize(editor.Nodes.Pool.size());
+    for (int depth_idx = 0; depth_idx < depth_stack.Size; ++depth_idx)
+    {
+        depth_indices[depth_stack[depth_idx]] = depth_idx;
+    }
+}
+
 bool MouseInCanvas()
 {
     // This flag should be true either when hovering or clicking something in the canvas.
@@ -728,10 +1041,16 @@ void BoxSelectorUpdateSelection(ImNodesEditorContext& editor, ImRect box_rect)
 
     editor.SelectedNodeIndices.clear();
 
-    // Test for overlap against node rectangles
+    // Test for overlap against the node rectangles near the box
 
-    for (int node_idx = 0; node_idx < editor.Nodes.Pool.size(); ++node_idx)
+    const ImRect   grid_box_rect = ScreenSpaceToGridSpace(editor, box_rect);
+    ImVector<int>& nearby_node_indices = GImNodes->NearbyNodeIndices;
+    editor.Grid.Query(
+        ImSpatialGridList_Nodes, grid_box_rect, editor.Nodes.Pool.size(), nearby_node_indices);
+
+    for (int i = 0; i < nearby_node_indices.size(); ++i)
     {
+        const int node_idx = nearby_node_indices[i];
         if (editor.Nodes.InUse[node_idx])
         {
             ImNodeData& node = editor.Nodes.Pool[node_idx];
@@ -746,10 +1065,17 @@ void BoxSelectorUpdateSelection(ImNodesEditorContext& editor, ImRect box_rect)
 
     editor.SelectedLinkIndices.clear();
 
-    // Test for overlap against links
+    // Test for overlap against the links near the box. Links are otherwise placed while hovering,
+    // which doesn't happen during box selection.
 
-    for (int link_idx = 0; link_idx < editor.Links.Pool.size(); ++link_idx)
+    SpatialGridUpdateLinks(editor);
+    ImVector<int>& nearby_link_indices = GImNodes->NearbyLinkIndices;
+    editor.Grid.Query(
+        ImSpatialGridList_Links, grid_box_rect, editor.Links.Pool.size(), nearby_link_indices);
+
+    for (int i = 0; i < nearby_link_indices.size(); ++i)
     {
+        const int link_idx = nearby_link_indices[i];
         if (editor.Links.InUse[link_idx])
         {
             const ImLinkData& link = editor.Links.Pool[link_idx];
@@ -784,7 +1110,19 @@ void TranslateSelectedNodes(ImNodesEditorContext& editor)
             ImNodeData& node = editor.Nodes.Pool[node_idx];
             if (node.Draggable)
             {
-                node.Origin += io.MouseDelta - editor.AutoPanningDelta;
+                const ImVec2 delta = io.MouseDelta - editor.AutoPanningDelta;
+                node.Origin += delta;
+
+                // Keep the grid up to date without waiting for the node to be submitted again.
+                ImRect grid_rect = GetNodeGridRect(editor, node);
+                grid_rect.Translate(delta);
+                editor.Grid.Move(ImSpatialGridList_Nodes, node_idx, node.GridCells, grid_rect);
+
+                for (int pin = 0; pin < node.PinIndices.size(); ++pin)
+                {
+                    const int pin_idx = node.PinIndices[pin];
+                    SpatialGridMovePin(editor, pin_idx, editor.Pins.Pool[pin_idx].GridPos + delta);
+                }
             }
         }
     }
@@ -1063,6 +1401,8 @@ void ClickInteractionUpdate(ImNodesEditorContext& editor)
     }
 }
 
+// Only pins within hover distance of the mouse are considered, they are the only ones that
+// ResolveHoveredPin() could pick.
 void ResolveOccludedPins(const ImNodesEditorContext& editor, ImVector<int>& occluded_pin_indices)
 {
     const ImVector<int>& depth_stack = editor.NodeDepthOrder;
@@ -1074,26 +1414,54 @@ void ResolveOccludedPins(const ImNodesEditorContext& editor, ImVector<int>& occl
         return;
     }
 
-    // For each node in the depth stack
-    for (int depth_idx = 0; depth_idx < (depth_stack.Size - 1); ++depth_idx)
+    const float hover_radius = GImNodes->Style.PinHoverRadius;
+    const ImRect mouse_rect = GetGridQueryRect(editor, GImNodes->MousePos, hover_radius);
+
+    const ImSpatialGrid& grid = editor.Grid;
+    ImVector<int>&       nearby_node_indices = GImNodes->NearbyNodeIndices;
+    grid.Query(ImSpatialGridList_Nodes, mouse_rect, editor.Nodes.Pool.size(), nearby_node_indices);
+
+    const ImVector<int>& depth_indices = GImNodes->NodeDepthIndices;
+
+    // For each node near the mouse
+    for (int i = 0; i < nearby_node_indices.Size; ++i)
     {
-        const ImNodeData& node_below = editor.Nodes.Pool[depth_stack[depth_idx]];
+        const int node_below_idx = nearby_node_indices[i];
+        if (!editor.Nodes.InUse[node_below_idx])
+        {
+            continue;
+        }
 
-        // Iterate over the rest of the depth stack to find nodes overlapping the pins
-        for (int next_depth_idx = depth_idx + 1; next_depth_idx < depth_stack.Size;
-             ++next_depth_idx)
+        const ImNodeData& node_below = editor.Nodes.Pool[node_below_idx];
+
+        // Iterate over each pin which could be hovered
+        for (int idx = 0; idx < node_below.PinIndices.Size; ++idx)
         {
-            const ImRect& rect_above = editor.Nodes.Pool[depth_stack[next_depth_idx]].Rect;
+            const int     pin_idx = node_below.PinIndices[idx];
+            const ImVec2& pin_pos = editor.Pins.Pool[pin_idx].Pos;
 
-            // Iterate over each pin
-            for (int idx = 0; idx < node_below.PinIndices.Size; ++idx)
+            if (ImLengthSqr(pin_pos - GImNodes->MousePos) >= hover_radius * hover_radius)
             {
-                const int     pin_idx = node_below.PinIndices[idx];
-                const ImVec2& pin_pos = editor.Pins.Pool[pin_idx].Pos;
+                continue;
+            }
+
+            // Find nodes above the node overlapping the pin
+            ImVector<int>& overlapping_node_indices = GImNodes->OverlappingNodeIndices;
+            grid.Query(
+                ImSpatialGridList_Nodes,
+                GetGridQueryRect(editor, pin_pos, 0.f),
+                editor.Nodes.Pool.size(),
+                overlapping_node_indices);
 
-                if (rect_above.Contains(pin_pos))
+            for (int j = 0; j < overlapping_node_indices.Size; ++j)
+            {
+                const int node_above_idx = overlapping_node_indices[j];
+                if (editor.Nodes.InUse[node_above_idx] &&
+                    depth_indices[node_above_idx] > depth_indices[node_below_idx] &&
+                    editor.Nodes.Pool[node_above_idx].Rect.Contains(pin_pos))
                 {
                     occluded_pin_indices.push_back(pin_idx);
+                    break;
                 }
             }
         }
@@ -1101,44 +1469,67 @@ void ResolveOccludedPins(const ImNodesEditorContext& editor, ImVector<int>& occl
 }
 
 ImOptionalIndex ResolveHoveredPin(
-    const ImObjectPool<ImPinData>& pins,
-    const ImVector<int>&           occluded_pin_indices)
+    const ImNodesEditorContext& editor,
+    const ImVector<int>&        occluded_pin_indices)
 {
     float           smallest_distance = FLT_MAX;
     ImOptionalIndex pin_idx_with_smallest_distance;
 
     const float hover_radius_sqr = GImNodes->Style.PinHoverRadius * GImNodes->Style.PinHoverRadius;
 
-    for (int idx = 0; idx < pins.Pool.Size; ++idx)
+    // Pins sit on the sides of their nodes, so only the pins of nodes near the mouse are tested.
+    ImVector<int>& nearby_node_indices = GImNodes->NearbyNodeIndices;
+    editor.Grid.Query(
+        ImSpatialGridList_Nodes,
+        GetGridQueryRect(editor, GImNodes->MousePos, GImNodes->Style.PinHoverRadius),
+        editor.Nodes.Pool.size(),
+        nearby_node_indices);
+
+    for (int i = 0; i < nearby_node_indices.Size; ++i)
     {
-        if (!pins.InUse[idx])
+        if (!editor.Nodes.InUse[nearby_node_indices[i]])
         {
             continue;
         }
 
-        if (occluded_pin_indices.contains(idx))
+        const ImNodeData& node = editor.Nodes.Pool[nearby_node_indices[i]];
+        for (int pin = 0; pin < node.PinIndices.Size; ++pin)
         {
-            continue;
-        }
+            const int idx = node.PinIndices[pin];
+            if (!editor.Pins.InUse[idx])
+            {
+                continue;
+            }
 
-        const ImVec2& pin_pos = pins.Pool[idx].Pos;
-        const float   distance_sqr = ImLengthSqr(pin_pos - GImNodes->MousePos);
+            if (occluded_pin_indices.contains(idx))
+            {
+                continue;
+            }
 
-        // TODO: GImNodes->Style.PinHoverRadius needs to be copied into pin data and the pin-local
-        // value used here. This is no longer called in BeginAttribute/EndAttribute scope and the
-        // detected pin might have a different hover radius than what the user had when calling
-        // BeginAttribute/EndAttribute.
-        if (distance_sqr < hover_radius_sqr && distance_sqr < smallest_distance)
-        {
-            smallest_distance = distance_sqr;
-            pin_idx_with_smallest_distance = idx;
+            const ImVec2& pin_pos = editor.Pins.Pool[idx].Pos;
+            const float   distance_sqr = ImLengthSqr(pin_pos - GImNodes->MousePos);
+
+            // TODO: GImNodes->Style.PinHoverRadius needs to be copied into pin data and the
+            // pin-local value used here. This is no longer called in BeginAttribute/EndAttribute
+            // scope and the detected pin might have a different hover radius than what the user
+            // had when calling BeginAttribute/EndAttribute.
+            //
+            // Ties go to the lowest pin index, as when all pins were scanned in order.
+            if (distance_sqr < hover_radius_sqr &&
+                (distance_sqr < smallest_distance ||
+                 (distance_sqr == smallest_distance &&
+                  idx < pin_idx_with_smallest_distance.Value())))
+            {
+                smallest_distance = distance_sqr;
+                pin_idx_with_smallest_distance = idx;
+            }
         }
     }
 
     return pin_idx_with_smallest_distance;
 }
 
-ImOptionalIndex ResolveHoveredNode(const ImVector<int>& depth_stack)
+ImOptionalIndex ResolveHoveredNode()
 {
     if (GImNodes->NodeIndicesOverlappingWithMouse.size() == 0)
     {
@@ -1156,13 +1547,11 @@ ImOptionalIndex ResolveHoveredNode(const ImVector<int>& depth_stack)
     for (int i = 0; i < GImNodes->NodeIndicesOverlappingWithMouse.size(); ++i)
     {
         const int node_idx = GImNodes->NodeIndicesOverlappingWithMouse[i];
-        for (int depth_idx = 0; depth_idx < depth_stack.size(); ++depth_idx)
+        const int depth_idx = GImNodes->NodeDepthIndices[node_idx];
+        if (depth_idx > largest_depth_idx)
         {
-            if (depth_stack[depth_idx] == node_idx && (depth_idx > largest_depth_idx))
-            {
-                largest_depth_idx = depth_idx;
-                node_idx_on_top = node_idx;
-            }
+            largest_depth_idx = depth_idx;
+            node_idx_on_top = node_idx;
         }
     }
 
@@ -1170,10 +1559,11 @@ ImOptionalIndex ResolveHoveredNode(const ImVector<int>& depth_stack)
     return ImOptionalIndex(node_idx_on_top);
 }
 
-ImOptionalIndex ResolveHoveredLink(
-    const ImObjectPool<ImLinkData>& links,
-    const ImObjectPool<ImPinData>&  pins)
+ImOptionalIndex ResolveHoveredLink(const ImNodesEditorContext& editor)
 {
+    const ImObjectPool<ImLinkData>& links = editor.Links;
+    const ImObjectPool<ImPinData>&  pins = editor.Pins;
+
     float           smallest_distance = FLT_MAX;
     ImOptionalIndex link_idx_with_smallest_distance;
 
@@ -1184,9 +1574,25 @@ ImOptionalIndex ResolveHoveredLink(
     //
     // The latter is a requirement for link detaching with drag click to work, as both a link and
     // pin are required to be hovered over for the feature to work.
+    //
+    // Either way the link's bounding box contains the point, the mouse or the pin, so only the
+    // links in the grid cell of that point are tested. They come in ascending order, ties still
+    // go to the lowest index.
+
+    const ImVec2 point = GImNodes->HoveredPinIdx.HasValue()
+                             ? pins.Pool[GImNodes->HoveredPinIdx.Value()].Pos
+                             : GImNodes->MousePos;
+
+    ImVector<int>& nearby_link_indices = GImNodes->NearbyLinkIndices;
+    editor.Grid.Query(
+        ImSpatialGridList_Links,
+        GetGridQueryRect(editor, point, 0.f),
+        links.Pool.Size,
+        nearby_link_indices);
 
-    for (int idx = 0; idx < links.Pool.Size; ++idx)
+    for (int i = 0; i < nearby_link_indices.Size; ++i)
     {
+        const int idx = nearby_link_indices[i];
         if (!links.InUse[idx])
         {
             continue;
@@ -2223,23 +2629,27 @@ void EndNodeEditor()
          editor.ClickInteraction.Type == ImNodesClickInteractionType_LinkCreation) &&
         MouseInCanvas() && !IsMiniMapHovered())
     {
+        // Links are placed in the grid now that both ends of every link have been submitted.
+        SpatialGridUpdateLinks(editor);
+        UpdateNodeDepthIndices(editor);
+
         // Pins needs some special care. We need to check the depth stack to see which pins are
         // being occluded by other nodes.
         ResolveOccludedPins(editor, GImNodes->OccludedPinIndices);
 
-        GImNodes->HoveredPinIdx = ResolveHoveredPin(editor.Pins, GImNodes->OccludedPinIndices);
+        GImNodes->HoveredPinIdx = ResolveHoveredPin(editor, GImNodes->OccludedPinIndices);
 
         if (!GImNodes->HoveredPinIdx.HasValue())
         {
             // Resolve which node is actually on top and being hovered using the depth stack.
-            GImNodes->HoveredNodeIdx = ResolveHoveredNode(editor.NodeDepthOrder);
+            GImNodes->HoveredNodeIdx = ResolveHoveredNode();
         }
 
         // We don't check for hovered pins here, because if we want to detach a link by clicking and
         // dragging, we need to have both a link and pin hovered.
         if (!GImNodes->HoveredNodeIdx.HasValue())
         {
-            GImNodes->HoveredLinkIdx = ResolveHoveredLink(editor.Links, editor.Pins);
+            GImNodes->HoveredLinkIdx = ResolveHoveredLink(editor);
         }
     }
 
@@ -2420,6 +2830,22 @@ void EndNode()
     node.Rect = GetItemRect();
     node.Rect.Expand(node.LayoutStyle.Padding);
 
+    // Place the pins now rather than when drawing them, hit testing happens before drawing and
+    // finds pins through the grid cells of their node.
+    for (int i = 0; i < node.PinIndices.size(); ++i)
+    {
+        const int  pin_idx = node.PinIndices[i];
+        ImPinData& pin = editor.Pins.Pool[pin_idx];
+        pin.Pos = GetScreenSpacePinCoordinates(node.Rect, pin.AttributeRect, pin.Type);
+        SpatialGridMovePin(editor, pin_idx, ScreenSpaceToGridSpace(editor, pin.Pos));
+    }
+
+    editor.Grid.Move(
+        ImSpatialGridList_Nodes,
+        GImNodes->CurrentNodeIdx,
+        node.GridCells,
+        GetNodeGridRect(editor, node));
+
     editor.GridContentBounds.Add(node.Origin);
     editor.GridContentBounds.Add(node.Origin + node.Rect.GetSize());
 
@@ -2521,10 +2947,20 @@ void Link(const int id, const int start_attr_id, const int end_attr_id)
     assert(GImNodes->CurrentScope == ImNodesScope_Editor);
 
     ImNodesEditorContext& editor = EditorContextGet();
-    ImLinkData&           link = ObjectPoolFindOrCreateObject(editor.Links, id);
+    const int             link_idx = ObjectPoolFindOrCreateIndex(editor.Links, id);
+    ImLinkData&           link = editor.Links.Pool[link_idx];
     link.Id = id;
-    link.StartPinIdx = ObjectPoolFindOrCreateIndex(editor.Pins, start_attr_id);
-    link.EndPinIdx = ObjectPoolFindOrCreateIndex(editor.Pins, end_attr_id);
+
+    // A link is placed in the grid when it's new or attached to other pins, after that only
+    // when one of its pins moves.
+    const int start_pin_idx = ObjectPoolFindOrCreateIndex(editor.Pins, start_attr_id);
+    const int end_pin_idx = ObjectPoolFindOrCreateIndex(editor.Pins, end_attr_id);
+    if (link.StartPinIdx != start_pin_idx || link.EndPinIdx != end_pin_idx)
+    {
+        link.StartPinIdx = start_pin_idx;
+        link.EndPinIdx = end_pin_idx;
+        SpatialGridAttachLink(editor, link_idx);
+    }
     link.ColorStyle.Base = GImNodes->Style.Colors[ImNodesCol_Link];
     link.ColorStyle.Hovered = GImNodes->Style.Colors[ImNodesCol_LinkHovered];
     link.ColorStyle.Selected = GImNodes->Style.Colors[ImNodesCol_LinkSelected];
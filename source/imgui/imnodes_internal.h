@@ -24,6 +24,7 @@ typedef int ImNodesAttributeType;
 typedef int ImNodesUIState;
 typedef int ImNodesClickInteractionType;
 typedef int ImNodesLinkCreationType;
+typedef int ImSpatialGridList;
 
 enum ImNodesScope_
 {
@@ -65,6 +66,13 @@ enum ImNodesLinkCreationType_
     ImNodesLinkCreationType_FromDetach
 };
 
+enum ImSpatialGridList_
+{
+    ImSpatialGridList_Nodes,
+    ImSpatialGridList_Links,
+    ImSpatialGridList_COUNT
+};
+
 // [SECTION] internal data structures
 
 // The object T must have the following interface:
@@ -84,6 +92,18 @@ struct ImObjectPool
     ImGuiStorage   IdMap;
 
     ImObjectPool() : Pool(), InUse(), FreeList(), IdMap() {}
+
+    ~ImObjectPool()
+    {
+        // Objects in the free list were destroyed when they were freed.
+        for (int i = 0; i < Pool.Size; ++i)
+        {
+            if (IdMap.GetInt(static_cast<ImGuiID>(Pool[i].Id), -1) == i)
+            {
+                Pool[i].~T();
+            }
+        }
+    }
 };
 
 // Emulates std::optional<int> using the sentinel value `INVALID_INDEX`.
@@ -126,6 +146,37 @@ private:
     int _Index;
 };
 
+// The cells an object covers in the spatial grid, min and max inclusive.
+struct ImGridCellRange
+{
+    int MinX, MinY, MaxX, MaxY;
+
+    ImGridCellRange() : MinX(0), MinY(0), MaxX(-1), MaxY(-1) {}
+    ImGridCellRange(const int min_x, const int min_y, const int max_x, const int max_y)
+        : MinX(min_x), MinY(min_y), MaxX(max_x), MaxY(max_y)
+    {
+    }
+
+    inline bool IsEmpty() const { return MinX > MaxX || MinY > MaxY; }
+
+    inline int GetCellCount() const
+    {
+        return IsEmpty() ? 0 : (MaxX - MinX + 1) * (MaxY - MinY + 1);
+    }
+
+    inline bool Contains(const int x, const int y) const
+    {
+        return x >= MinX && x <= MaxX && y >= MinY && y <= MaxY;
+    }
+
+    inline bool operator==(const ImGridCellRange& rhs) const
+    {
+        return MinX == rhs.MinX && MinY == rhs.MinY && MaxX == rhs.MaxX && MaxY == rhs.MaxY;
+    }
+
+    inline bool operator!=(const ImGridCellRange& rhs) const { return !(*this == rhs); }
+};
+
 struct ImNodeData
 {
     int    Id;
@@ -146,13 +197,14 @@ struct ImNodeData
         float  BorderThickness;
     } LayoutStyle;
 
-    ImVector<int> PinIndices;
-    bool          Draggable;
+    ImVector<int>   PinIndices;
+    bool            Draggable;
+    ImGridCellRange GridCells;
 
     ImNodeData(const int node_id)
         : Id(node_id), Origin(100.0f, 100.0f), TitleBarContentRect(),
           Rect(ImVec2(0.0f, 0.0f), ImVec2(0.0f, 0.0f)), ColorStyle(), LayoutStyle(), PinIndices(),
-          Draggable(true)
+          Draggable(true), GridCells()
     {
     }
 
@@ -174,10 +226,16 @@ struct ImPinData
         ImU32 Background, Hovered;
     } ColorStyle;
 
+    // The links are placed in the grid from GridPos, and placed again when it moves. LinkIndices
+    // may still hold links that were removed or attached elsewhere since.
+    ImVec2        GridPos;
+    ImVector<int> LinkIndices;
+    bool          Moved;
+
     ImPinData(const int pin_id)
         : Id(pin_id), ParentNodeIdx(), AttributeRect(), Type(ImNodesAttributeType_None),
           Shape(ImNodesPinShape_CircleFilled), Pos(), Flags(ImNodesAttributeFlags_None),
-          ColorStyle()
+          ColorStyle(), GridPos(), LinkIndices(), Moved(false)
     {
     }
 };
@@ -192,7 +250,58 @@ struct ImLinkData
         ImU32 Base, Hovered, Selected;
     } ColorStyle;
 
-    ImLinkData(const int link_id) : Id(link_id), StartPinIdx(), EndPinIdx(), ColorStyle() {}
+    ImGridCellRange GridCells;
+    bool            NeedsPlacing;
+
+    // The pins are unset until the link is first submitted.
+    ImLinkData(const int link_id)
+        : Id(link_id), StartPinIdx(-1), EndPinIdx(-1), ColorStyle(), GridCells(),
+          NeedsPlacing(false)
+    {
+    }
+};
+
+struct ImSpatialGridCell
+{
+    int           X, Y;
+    ImVector<int> Indices[ImSpatialGridList_COUNT];
+
+    ImSpatialGridCell(const int x, const int y) : X(x), Y(y) {}
+};
+
+// A uniform grid over grid space. Node rectangles and link bounding boxes are listed in the cells
+// they overlap, so hit testing only looks at the objects near the mouse or the box selector.
+// Objects move between cells only when the range of cells they cover changes, and since grid
+// space does not move with panning, neither does the grid.
+struct ImSpatialGrid
+{
+    static const int CELL_SIZE = 256;
+
+    ImVector<ImSpatialGridCell> Cells;
+    ImGuiStorage                CellMap; // cell key -> index into Cells
+
+    // Query results are deduplicated by marking the objects found with the query number.
+    mutable ImVector<unsigned int> Marks[ImSpatialGridList_COUNT];
+    mutable unsigned int           QueryMark;
+
+    ImSpatialGrid() : Cells(), CellMap(), QueryMark(0) {}
+
+    ~ImSpatialGrid()
+    {
+        for (int i = 0; i < Cells.Size; ++i)
+        {
+            Cells[i].~ImSpatialGridCell();
+        }
+    }
+
+    ImGridCellRange GetCellRange(const ImRect& grid_rect) const;
+    void            Insert(ImSpatialGridList list, int idx, const ImGridCellRange& range);
+    void            Remove(ImSpatialGridList list, int idx, const ImGridCellRange& range);
+    void            Move(ImSpatialGridList list, int idx, ImGridCellRange& range, const ImRect& grid_rect);
+    // Indices of the objects in the cells the rect overlaps, in ascending order. Objects are
+    // only near the rect, callers still test them. pool_size bounds the indices.
+    void Query(ImSpatialGridList list, const ImRect& grid_rect, int pool_size, ImVector<int>& indices)
+        const;
 };
 
 struct ImClickInteractionState
@@ -249,6 +358,12 @@ struct ImNodesEditorContext
 
     ImVector<int> NodeDepthOrder;
 
+    ImSpatialGrid Grid;
+    // Pins that moved and links that need placing in the grid since links were last placed.
+    ImVector<int> MovedPinIndices;
+    ImVector<int> UnplacedLinkIndices;
+    float         LinkGridHoverDistance; // The LinkHoverDistance the links were placed with
+
     // ui related fields
     ImVec2 Panning;
     ImVec2 AutoPanningDelta;
@@ -276,7 +391,8 @@ struct ImNodesEditorContext
     float  MiniMapScaling;
 
     ImNodesEditorContext()
-        : Nodes(), Pins(), Links(), Panning(0.f, 0.f), SelectedNodeIndices(), SelectedLinkIndices(),
+        : Nodes(), Pins(), Links(), MovedPinIndices(), UnplacedLinkIndices(),
+          LinkGridHoverDistance(0.f), Panning(0.f, 0.f), SelectedNodeIndices(), SelectedLinkIndices(),
           ClickInteraction(), MiniMapEnabled(false), MiniMapSizeFraction(0.0f),
           MiniMapNodeHoveringCallback(NULL), MiniMapNodeHoveringCallbackUserData(NULL),
           MiniMapScaling(0.0f)
@@ -296,6 +412,12 @@ struct ImNodesContext
     ImVector<int> NodeIndicesOverlappingWithMouse;
     ImVector<int> OccludedPinIndices;
 
+    // Scratch for hit testing
+    ImVector<int> NodeDepthIndices; // node idx -> position in the depth stack
+    ImVector<int> NearbyNodeIndices;
+    ImVector<int> OverlappingNodeIndices;
+    ImVector<int> NearbyLinkIndices;
+
     // Canvas extents
     ImVec2 CanvasOriginScreenSpace;
     ImRect CanvasRectScreenSpace;
@@ -401,6 +523,9 @@ inline void ObjectPoolUpdate(ImObjectPool<ImNodeData>& nodes)
                 assert(elem != depth_stack.end());
                 depth_stack.erase(elem);
 
+                EditorContextGet().Grid.Remove(
+                    ImSpatialGridList_Nodes, i, nodes.Pool[i].GridCells);
+
                 nodes.IdMap.SetInt(id, -1);
                 nodes.FreeList.push_back(i);
                 (nodes.Pool.Data + i)->~ImNodeData();
@@ -409,6 +534,24 @@ inline void ObjectPoolUpdate(ImObjectPool<ImNodeData>& nodes)
     }
 }
 
+template<>
+inline void ObjectPoolUpdate(ImObjectPool<ImLinkData>& links)
+{
+    for (int i = 0; i < links.InUse.size(); ++i)
+    {
+        const int id = links.Pool[i].Id;
+
+        if (!links.InUse[i] && links.IdMap.GetInt(id, -1) == i)
+        {
+            EditorContextGet().Grid.Remove(ImSpatialGridList_Links, i, links.Pool[i].GridCells);
+
+            links.IdMap.SetInt(id, -1);
+            links.FreeList.push_back(i);
+            (links.Pool.Data + i)->~ImLinkData();
+        }
+    }
+}
+
 template<typename T>
 static inline void ObjectPoolReset(ImObjectPool<T>& objects)
 {
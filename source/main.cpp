@@ -10,6 +10,7 @@
 #include "RichTextDocument.h"
 #include "imnodes_internal.h"
 #include "misc/freetype/imgui_freetype.h"
+#include <algorithm>
 #include <cstddef>
 #include <nlohmann/json.hpp>
 #define SDL_MAIN_HANDLED
@@ -35,6 +36,13 @@
 #include "node.hpp"
 #include "graph.h"
 #include "RichTextEditor.h"
+#include "AllocationCounter.h"
+#include "FontAtlasCache.h"
+#include "FontGlyphCache.h"
+#include "script.hpp"
+#include "ScriptPdfExporter.h"
+#include "StoryGraphAnalysis.h"
+#include "StoryRuntime.h"
 
 
 // Main code
@@ -114,6 +122,7 @@ int main(int, char**)
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
+    AllocationCounter::CountImGuiAllocations();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
@@ -134,6 +143,7 @@ int main(int, char**)
 
     ImNodes::CreateContext();
     ImNodes::StyleColorsLight();
+    ImNodes::GetIO().LinkDetachWithModifierClick.Modifier = &ImGui::GetIO().KeyCtrl;
 
     // Load Fonts
     // - If no fonts are loaded, dear imgui will use the default font. You can also load multiple fonts and use ImGui::PushFont()/PopFont() to select them.
@@ -145,45 +155,69 @@ int main(int, char**)
     // - Remember that in C/C++ if you want to include a backslash \ in a string literal you need to write a double backslash \\ !
     // - Our Emscripten build process allows embedding fonts to be accessible at runtime from the "fonts/" folder. See Makefile.emscripten for details.
     // io.Fonts->AddFontDefault();
-    static ImWchar ranges[] = { 0x1, (ImWchar)0x1FFFF, 0 };
-    
+    // Only glyphs that are actually drawn get rasterized, the glyph cache grows the atlas on demand.
+    FontGlyphCache glyphCache(io.Fonts);
+    const ImWchar* ranges = glyphCache.GetGlyphRanges();
+
     ImFontConfig fontCfg;
     fontCfg.OversampleH = 2;
     fontCfg.OversampleV = 2;
     //fontCfg.RasterizerMultiply = 1.5f;
     fontCfg.RasterizerDensity = windowScale;
 
+    // The emoji font is added once and shared by all four variants through the glyph cache
+    // instead of being merged into each of them.
     ImFontConfig emojiCfg;
     emojiCfg.OversampleH = 2;
     emojiCfg.OversampleV = 2;
     //emojiCfg.RasterizerMultiply = 1.5f;
     emojiCfg.RasterizerDensity = windowScale;
-    emojiCfg.MergeMode = true;
     emojiCfg.FontBuilderFlags |= ImGuiFreeTypeBuilderFlags_LoadColor;
 
-    ImFont* font = io.Fonts->AddFontFromFileTTF("resource/CourierPrime-Regular.ttf", windowScale * 18.0f, &fontCfg, io.Fonts->GetGlyphRangesDefault());
-    io.Fonts->AddFontFromFileTTF("resource/Twemoji.Mozilla.ttf", windowScale * 18.0f, &emojiCfg, ranges);
-
+    ImFont* font = io.Fonts->AddFontFromFileTTF("resource/CourierPrime-Regular.ttf", windowScale * 18.0f, &fontCfg, ranges);
     ImFont* fontBold = io.Fonts->AddFontFromFileTTF("resource/CourierPrime-Bold.ttf", windowScale * 18.0f, &fontCfg, ranges);
-    io.Fonts->AddFontFromFileTTF("resource/Twemoji.Mozilla.ttf", windowScale * 18.0f, &emojiCfg, ranges);
-
     ImFont* fontItalic = io.Fonts->AddFontFromFileTTF("resource/CourierPrime-Italic.ttf", windowScale * 18.0f, &fontCfg, ranges);
-    io.Fonts->AddFontFromFileTTF("resource/Twemoji.Mozilla.ttf", windowScale * 18.0f, &emojiCfg, ranges);
-
     ImFont* fontItalicBold = io.Fonts->AddFontFromFileTTF("resource/CourierPrime-BoldItalic.ttf", windowScale * 18.0f, &fontCfg, ranges);
-    io.Fonts->AddFontFromFileTTF("resource/Twemoji.Mozilla.ttf", windowScale * 18.0f, &emojiCfg, ranges);
+    ImFont* fontEmoji = io.Fonts->AddFontFromFileTTF("resource/Twemoji.Mozilla.ttf", windowScale * 18.0f, &emojiCfg, ranges);
 
-    IM_ASSERT(font != nullptr && fontBold != nullptr && fontItalic != nullptr && fontItalicBold != nullptr);
+    IM_ASSERT(font != nullptr && fontBold != nullptr && fontItalic != nullptr && fontItalicBold != nullptr && fontEmoji != nullptr);
+    glyphCache.SetFallbackFont(fontEmoji);
+
+    // A warm start restores the atlas built by the last launch instead of rasterizing again.
+    const std::string fontAtlasCachePath = "fontatlas.cache";
+    const uint64_t fontAtlasCacheKey = FontAtlasCache::ComputeKey(io.Fonts, &glyphCache);
+    if (!FontAtlasCache::Load(io.Fonts, fontAtlasCachePath, fontAtlasCacheKey, &glyphCache))
+    {
+        io.Fonts->Build();
+        FontAtlasCache::Save(io.Fonts, fontAtlasCachePath, fontAtlasCacheKey, &glyphCache);
+    }
+    bool fontAtlasGrew = false; // Written back once at shutdown rather than on every growth.
+    glyphCache.ShareFallbackGlyphs();
 
     // Our state
     bool show_demo_window = true;
     bool show_another_window = false;
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
-    std::string node_1_name;
-    std::string node_2_name;
+    // The node editor draws the story graph. Node ids are never negative, so a node's output
+    // pin takes the node's id and its input pin -1 - id. Links are the graph's edges.
+    StoryGraph graph;
+    auto inputPin = [](int node) { return -1 - node; };
+    std::string nodeName;
+
+    StoryGraphAnalysis storyAnalysis(&graph);
+    {
+        auto scene = graph.insert_node(Node(NodeType::Script));
+        auto option = graph.insert_node(Node(NodeType::Option));
+        graph.insert_edge(scene, option);
+        ImNodes::SetNodeGridSpacePos(scene, ImVec2(40.0f, 40.0f));
+        ImNodes::SetNodeGridSpacePos(option, ImVec2(240.0f, 40.0f));
+        storyAnalysis.SetStartNode(scene);
+    }
 
-    example::Graph<Node> graph;
+    StoryRuntime storyRuntime;
+    StoryReport storyReport;
+    std::vector<uint32_t> storyChoices; // Compiled nodes with more than one link out.
 
     auto json = nlohmann::json::parse(R"(
         {
@@ -206,9 +240,13 @@ int main(int, char**)
         )");
 
     RichTextDocument doc{json};
+    ScriptPaginator paginator(&doc);
     RichTextEditor editor{font, fontBold, fontItalic, fontItalicBold};
     editor.SetDocument(doc);
+    editor.SetPaginator(&paginator);
+    ScriptPdfExporter pdfExporter;
     editor.SetDPIScaling(windowScale);
+    editor.SetGlyphCache(&glyphCache);
 
     ImNodes::GetStyle().GridSpacing *= windowScale;
 
@@ -243,11 +281,23 @@ int main(int, char**)
             continue;
         }
 
+        // Rasterize the glyphs text asked for last frame. The backend uploads the font
+        // texture again when it finds it missing.
+        if (glyphCache.Update())
+        {
+            ImGui_ImplOpenGL3_DestroyFontsTexture();
+            fontAtlasGrew = true;
+        }
+
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplSDL3_NewFrame();
         ImGui::NewFrame();
 
+        // Characters typed into any widget this frame.
+        for (ImWchar c : io.InputQueueCharacters)
+            glyphCache.Request(c);
+
         // ImGui::PushFont(font);
 
         // 1. Show the big demo window (Most of the sample code is in ImGui::ShowDemoWindow()! You can browse its code to learn more about Dear ImGui!).
@@ -269,58 +319,104 @@ int main(int, char**)
         ImGui::Begin("Nodes!");
         ImNodes::BeginNodeEditor();
 
-        const float node_width = 60.0f;
-
-        ImNodes::BeginNode(0);
-
-        ImNodes::BeginNodeTitleBar();
-        ImGui::SetNextItemWidth(node_width - 25.0f);
-        ImGui::InputText("", &node_1_name);
-        ImNodes::EndNodeTitleBar();
-
-        ImNodes::BeginInputAttribute(0);
-        ImGui::Text("In");
-        ImNodes::EndInputAttribute();
-
-        ImGui::SameLine();
+        // Right clicking the canvas adds a scene or an option where it was clicked.
+        if (ImNodes::IsEditorHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right))
+            ImGui::OpenPopup("Add node");
+        if (ImGui::BeginPopup("Add node"))
+        {
+            auto position = ImGui::GetMousePosOnOpeningCurrentPopup();
+            auto add = [&](NodeType type) { ImNodes::SetNodeScreenSpacePos(graph.insert_node(Node(type)), position); };
+            if (ImGui::MenuItem("Scene"))
+                add(NodeType::Script);
+            if (ImGui::MenuItem("Option"))
+                add(NodeType::Option);
+            ImGui::EndPopup();
+        }
 
-        ImNodes::BeginOutputAttribute(1);
+        const float node_width = 60.0f;
         const float label_width = ImGui::CalcTextSize("Out").x;
-        ImGui::Indent(node_width - label_width);
-        ImGui::TextUnformatted("Out");
-        ImNodes::EndOutputAttribute();
-
-        ImNodes::EndNode();
 
-        ImNodes::BeginNode(3);
+        for (int id : graph.nodes())
+        {
+            Node& node = graph.node(id);
+            ImNodes::BeginNode(id);
 
-        ImNodes::BeginNodeTitleBar();
-        ImGui::SetNextItemWidth(node_width + 25.0f);
-        ImGui::InputText("", &node_2_name);
-        ImNodes::EndNodeTitleBar();
+            ImNodes::BeginNodeTitleBar();
+            ImGui::TextUnformatted(node.GetType() == NodeType::Option ? "Option" : "Scene");
+            ImGui::SetNextItemWidth(node_width + 25.0f);
+            nodeName = node.GetName();
+            if (ImGui::InputText("##name", &nodeName))
+                node.SetName(nodeName);
+            ImNodes::EndNodeTitleBar();
 
-        ImNodes::BeginInputAttribute(2);
-        ImGui::Text("In");
-        ImNodes::EndInputAttribute();
+            ImNodes::BeginInputAttribute(inputPin(id));
+            ImGui::Text("In");
+            ImNodes::EndInputAttribute();
 
-        ImGui::SameLine();
+            ImGui::SameLine();
 
-        ImNodes::BeginOutputAttribute(3);
-        ImGui::Indent(node_width - label_width);
-        ImGui::TextUnformatted("Out");
-        ImNodes::EndOutputAttribute();
+            ImNodes::BeginOutputAttribute(id);
+            ImGui::Indent(node_width - label_width);
+            ImGui::TextUnformatted("Out");
+            ImNodes::EndOutputAttribute();
 
-        ImNodes::EndNode();
+            ImNodes::EndNode();
+        }
 
-        ImNodes::Link(8, 1, 2);
+        for (const auto& edge : graph.edges())
+            ImNodes::Link(edge.id, edge.from, inputPin(edge.to));
 
         ImNodes::MiniMap(0.2f, ImNodesMiniMapLocation_BottomRight);
   
         ImNodes::EndNodeEditor();
+
+        // Every edit goes through the graph, the story analysis follows its change journal.
+        int startPin, endPin;
+        if (ImNodes::IsLinkCreated(&startPin, &endPin))
+        {
+            // Links can be dragged out of either end.
+            if (startPin < 0)
+                std::swap(startPin, endPin);
+            auto to = -1 - endPin;
+            if (startPin >= 0 && endPin < 0 && graph.contains_node(startPin) && graph.contains_node(to))
+            {
+                auto neighbors = graph.neighbors(startPin);
+                if (std::find(neighbors.begin(), neighbors.end(), to) == neighbors.end())
+                    graph.insert_edge(startPin, to);
+            }
+        }
+
+        int destroyedLink;
+        if (ImNodes::IsLinkDestroyed(&destroyedLink) && graph.contains_edge(destroyedLink))
+            graph.erase_edge(destroyedLink);
+
+        // Delete erases the selected links and nodes, unless it goes to a node's name.
+        if (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) && !ImGui::IsAnyItemActive() && ImGui::IsKeyPressed(ImGuiKey_Delete, false))
+        {
+            std::vector<int> selected(static_cast<std::size_t>(ImNodes::NumSelectedLinks()));
+            if (!selected.empty())
+                ImNodes::GetSelectedLinks(selected.data());
+            for (int link : selected)
+                if (graph.contains_edge(link))
+                    graph.erase_edge(link);
+
+            selected.resize(static_cast<std::size_t>(ImNodes::NumSelectedNodes()));
+            if (!selected.empty())
+                ImNodes::GetSelectedNodes(selected.data());
+            selected.erase(std::remove_if(selected.begin(), selected.end(), [&graph](int node) { return !graph.contains_node(node); }), selected.end());
+            graph.erase_nodes(selected);
+
+            ImNodes::ClearLinkSelection();
+            ImNodes::ClearNodeSelection();
+        }
         ImGui::End();
 
         ImGui::Begin("Inspector");
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+        if (AllocationCounter::IsEnabled())
+            ImGui::Text("Script editor allocations: %zu/frame", editor.GetLastFrameAllocations());
+        if (ImGui::Button("Export PDF"))
+            pdfExporter.Export(doc, "script.pdf");
         int selected_count = ImNodes::NumSelectedNodes();
         if (selected_count > 0)
         {
@@ -331,6 +427,90 @@ int main(int, char**)
 
             auto position = ImNodes::GetNodeGridSpacePos(node);
             ImGui::Text("Node ID: %d\nNode Position: (%f, %f)", node, position.x, position.y);
+            if (graph.contains_node(node))
+            {
+                // The type is not part of the graph's journal, the analysis is told instead.
+                bool option = graph.node(node).GetType() == NodeType::Option;
+                if (ImGui::Checkbox("Option", &option))
+                {
+                    graph.node(node).SetType(option ? NodeType::Option : NodeType::Script);
+                    storyAnalysis.Invalidate();
+                }
+                if (ImGui::Button("Start story here"))
+                    storyAnalysis.SetStartNode(node);
+            }
+        }
+
+        // Follows the graph's changes, so this stays live on large graphs.
+        storyAnalysis.Update();
+        if (ImGui::CollapsingHeader("Story graph"))
+        {
+            ImGui::Text("%zu nodes, %zu loops", storyAnalysis.GetNodeCount(), storyAnalysis.GetLoopCount());
+            ImGui::Text("%zu unreachable, %zu dead-end options", storyAnalysis.GetUnreachableCount(), storyAnalysis.GetDeadEndCount());
+            if (!graph.contains_node(storyAnalysis.GetStartNode()))
+                ImGui::TextDisabled("No start node");
+            else if (storyAnalysis.GetShortestEnding() < 0)
+                ImGui::Text("No ending is reachable");
+            else
+                ImGui::Text("Endings after %d to %d links", storyAnalysis.GetShortestEnding(), storyAnalysis.GetLongestEnding());
+
+            auto listNodes = [](const char* label, const std::vector<int>& nodes) {
+                if (nodes.empty() || !ImGui::TreeNode(label, "%s (%zu)", label, nodes.size()))
+                    return;
+
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(nodes.size()));
+                while (clipper.Step())
+                    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+                        ImGui::BulletText("Node %d", nodes[i]);
+                ImGui::TreePop();
+            };
+            listNodes("Unreachable", storyAnalysis.GetUnreachableNodes());
+            listNodes("Dead-end options", storyAnalysis.GetDeadEndOptions());
+
+            // Playthroughs run on a compiled copy, play again after editing the graph.
+            bool playRandom = ImGui::Button("Play 1M at random");
+            ImGui::SameLine();
+            bool playAll = ImGui::Button("Play every path");
+            if ((playRandom || playAll) && storyRuntime.Compile(graph, storyAnalysis.GetStartNode()))
+            {
+                storyReport = playRandom ? storyRuntime.PlayRandom(1000000) : storyRuntime.PlayAll();
+                storyChoices.clear();
+                for (uint32_t node = 0; node < storyRuntime.GetNodeCount(); node++)
+                    if (storyRuntime.GetLinksEnd(node) - storyRuntime.GetLinksBegin(node) > 1 && storyReport.nodeVisits[node] > 0)
+                        storyChoices.push_back(node);
+            }
+
+            if (storyReport.playthroughs > 0)
+            {
+                ImGui::Text("%llu playthroughs, %llu reached an ending%s", (unsigned long long)storyReport.playthroughs,
+                    (unsigned long long)storyReport.finished, storyReport.complete ? ", every path" : "");
+                ImGui::Text("%llu distinct, %.1f links on average (%u to %u)", (unsigned long long)storyReport.distinctPaths,
+                    storyReport.GetAverageLength(), storyReport.shortest, storyReport.longest);
+                ImGui::Text("Visited %.1f%% of nodes, %.1f%% of links", storyReport.GetNodeCoverage() * 100.0, storyReport.GetLinkCoverage() * 100.0);
+
+                if (!storyChoices.empty() && ImGui::TreeNode("Choices", "Choices (%zu)", storyChoices.size()))
+                {
+                    ImGuiListClipper clipper;
+                    clipper.Begin(static_cast<int>(storyChoices.size()));
+                    while (clipper.Step())
+                    {
+                        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+                        {
+                            auto node = storyChoices[i];
+                            auto visits = static_cast<double>(storyReport.nodeVisits[node]);
+                            ImGui::Text("Node %d:", storyRuntime.GetNodeId(node));
+                            for (auto link = storyRuntime.GetLinksBegin(node); link < storyRuntime.GetLinksEnd(node); link++)
+                            {
+                                ImGui::SameLine();
+                                ImGui::Text("%.0f%% to %d", storyReport.linkCounts[link] * 100.0 / visits,
+                                    storyRuntime.GetNodeId(storyRuntime.GetLinkTarget(link)));
+                            }
+                        }
+                    }
+                    ImGui::TreePop();
+                }
+            }
         }
 
         ImGui::End();
@@ -353,6 +533,9 @@ int main(int, char**)
     EMSCRIPTEN_MAINLOOP_END;
 #endif
 
+    if (fontAtlasGrew)
+        FontAtlasCache::Save(io.Fonts, fontAtlasCachePath, fontAtlasCacheKey, &glyphCache);
+
     // Cleanup
     ImNodes::DestroyContext();
     ImGui_ImplOpenGL3_Shutdown();
@@ -1 +1,6 @@
-#include "node.hpp"
\ No newline at end of file
+#include "node.hpp"
+
+void Node::SetName(std::string_view name)
+{
+    _name = name;
+}
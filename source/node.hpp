@@ -18,12 +18,17 @@ enum class NodeType {
 
 class Node {
 public:
+    Node(NodeType type = NodeType::Script) : _type(type) {}
+
     void LoadFromJSON();
     void AddInputAttachment(std::string_view name, int attachmentID, NodeAttachmentType type = NodeAttachmentType::Flow);
     void AddOutputAttachment(std::string_view name, int attachmentID, NodeAttachmentType type = NodeAttachmentType::Flow);
     void RemoveAttachemnt(int attachmentID);
     void Link(int localAttachment, int toAttachment);
     void SetName(std::string_view name);
+    const std::string& GetName() const { return _name; }
+    NodeType GetType() const { return _type; }
+    void SetType(NodeType type) { _type = type; }
     //void SetUUID(Poco::UUID uuid);
     // Poco::UUID GetUUID();
     void Draw();
@@ -35,6 +40,7 @@ private:
         NodeAttachmentType type;
     };
 
+    NodeType _type;
     std::string _name;
     std::vector<Attachment> _inputAttachments;
     std::vector<Attachment> _outputAttachments;
@@ -0,0 +1,557 @@
+#include <algorithm>
+
+#include "script.hpp"
+
+// Cues longer than this are shouting action lines rather than a name.
+static constexpr std::size_t kMaxCharacterCueLength = 40;
+
+static std::string_view TrimWhitespace(std::string_view text)
+{
+    auto begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos)
+        return {};
+
+    auto end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+static bool IsSceneHeading(std::string_view text)
+{
+    // Longest first, INT./EXT. would otherwise stop at INT.
+    static const std::string_view kPrefixes[] = {"INT./EXT.", "EXT./INT.", "INT/EXT", "EXT/INT", "INT.", "EXT.", "EST.", "I/E"};
+
+    for (auto prefix : kPrefixes)
+    {
+        if (text.size() < prefix.size())
+            continue;
+
+        auto matches = std::equal(prefix.begin(), prefix.end(), text.begin(), [](char a, char b) {
+            return a == (b >= 'a' && b <= 'z' ? b - 'a' + 'A' : b);
+        });
+
+        // "INTERIOR" or "ESTHER" are not headings, the prefix has to end a word.
+        if (matches && (text.size() == prefix.size() || text[prefix.size()] == ' ' || text[prefix.size()] == '.' || text[prefix.size()] == '\t'))
+            return true;
+    }
+
+    return false;
+}
+
+static bool IsCharacterCue(std::string_view text)
+{
+    // Extensions like (V.O.) or (cont'd) do not count towards the name.
+    if (text.back() == ')')
+    {
+        auto extension = text.rfind('(');
+        if (extension != std::string_view::npos && extension > 0)
+            text = TrimWhitespace(text.substr(0, extension));
+    }
+
+    // Transitions such as CUT TO: are all caps too.
+    if (text.empty() || text.size() > kMaxCharacterCueLength || text.back() == ':')
+        return false;
+
+    auto hasLetter = false;
+    for (char c : text)
+    {
+        if (c >= 'a' && c <= 'z')
+            return false;
+        hasLetter |= c >= 'A' && c <= 'Z';
+    }
+
+    return hasLetter;
+}
+
+// Most paragraphs are a single run, those are returned in place and only paragraphs made of
+// several runs are joined into the scratch buffer.
+static std::string_view GetParagraphText(const RichTextDocument& doc, std::size_t paragraph, std::string& scratch)
+{
+    auto line = doc.GetLine(paragraph);
+    auto run = line.begin();
+    if (run == line.end())
+        return {};
+
+    auto text = run->text;
+    if (++run == line.end())
+        return text;
+
+    scratch.assign(text);
+    for (; run != line.end(); ++run)
+        scratch.append(run->text);
+    return scratch;
+}
+
+ScriptClassifier::ScriptClassifier(const RichTextDocument* doc)
+    : mDoc(doc)
+{
+}
+
+void ScriptClassifier::SetDocument(const RichTextDocument* doc)
+{
+    mDoc = doc;
+    mParagraphs.clear();
+    mInvalidCount = 0;
+    mVersion = 0;
+}
+
+ScriptWritingState ScriptClassifier::GetElement(std::size_t paragraph) const
+{
+    return paragraph < mParagraphs.size() ? mParagraphs[paragraph].element : ScriptWritingState::eNone;
+}
+
+void ScriptClassifier::Update()
+{
+    mLastClassifiedCount = 0;
+    mLastClassifiedEnd = 0;
+    if (!mDoc) return;
+
+    auto dirtyFrom = mParagraphs.size();
+
+    // Splice the elements to follow the edits, the paragraphs an edit touched are invalid.
+    auto inSync = mDoc->GetChangesSince(mVersion, mChanges);
+    if (inSync)
+    {
+        for (const auto& change : mChanges)
+        {
+            auto first = std::min(change.line, mParagraphs.size());
+            auto last = std::min(change.line + change.removedLines + 1, mParagraphs.size());
+            for (auto paragraph = first; paragraph < last; paragraph++)
+                mInvalidCount -= !mParagraphs[paragraph].valid;
+
+            // Typing within a paragraph replaces it one for one, only a changed paragraph
+            // count has to shift the rest of the script.
+            auto inserted = change.insertedLines + 1;
+            auto reused = std::min(last - first, inserted);
+            std::fill(mParagraphs.begin() + first, mParagraphs.begin() + first + reused, Paragraph());
+            if (last - first > inserted)
+                mParagraphs.erase(mParagraphs.begin() + first + reused, mParagraphs.begin() + last);
+            else
+                mParagraphs.insert(mParagraphs.begin() + first + reused, inserted - reused, Paragraph());
+            mInvalidCount += inserted;
+            dirtyFrom = std::min(dirtyFrom, first);
+        }
+    }
+
+    if (!inSync || mParagraphs.size() != mDoc->GetLineCount())
+    {
+        mParagraphs.assign(mDoc->GetLineCount(), Paragraph());
+        mInvalidCount = mParagraphs.size();
+        dirtyFrom = 0;
+    }
+
+    mVersion = mDoc->GetVersion();
+
+    // A paragraph only depends on the one before it. Once every invalid paragraph is
+    // classified and the last one came out as it was before, nothing after it can change.
+    auto previous = dirtyFrom > 0 && dirtyFrom <= mParagraphs.size() ? mParagraphs[dirtyFrom - 1].element : ScriptWritingState::eNone;
+    auto carry = false;
+    for (auto paragraph = dirtyFrom; paragraph < mParagraphs.size() && (mInvalidCount > 0 || carry); paragraph++)
+    {
+        auto& entry = mParagraphs[paragraph];
+        if (entry.valid && !carry)
+        {
+            previous = entry.element;
+            continue;
+        }
+
+        auto element = ClassifyParagraph(paragraph, previous);
+        carry = !entry.valid || element != entry.element;
+        mInvalidCount -= !entry.valid;
+        entry.element = element;
+        entry.valid = true;
+        previous = element;
+        mLastClassifiedCount++;
+        mLastClassifiedEnd = paragraph + 1;
+    }
+}
+
+ScriptWritingState ScriptClassifier::ClassifyParagraph(std::size_t paragraph, ScriptWritingState previous)
+{
+    return Classify(GetParagraphText(*mDoc, paragraph, mText), previous);
+}
+
+ScriptWritingState ScriptClassifier::Classify(std::string_view text, ScriptWritingState previous)
+{
+    text = TrimWhitespace(text);
+    if (text.empty())
+        return ScriptWritingState::eNone;
+
+    if (IsSceneHeading(text))
+        return ScriptWritingState::eHeading;
+
+    // Dialogue belongs to the cue right above it, a parenthetical may sit in between or
+    // interrupt it. Without a cue a line in parentheses is plain action.
+    auto underCue = previous == ScriptWritingState::eCharacter || previous == ScriptWritingState::eParenthetical;
+    if (text.front() == '(' && (underCue || previous == ScriptWritingState::eDialogue))
+        return ScriptWritingState::eParenthetical;
+
+    if (underCue)
+        return ScriptWritingState::eDialogue;
+
+    if (IsCharacterCue(text))
+        return ScriptWritingState::eCharacter;
+
+    return ScriptWritingState::eAction;
+}
+
+// Counts codepoints, continuation bytes do not start a character.
+static std::size_t CountCharacters(std::string_view text)
+{
+    std::size_t count = 0;
+    for (char c : text)
+        count += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+    return count;
+}
+
+// Moves forward over count characters starting at the byte offset.
+static std::size_t AdvanceCharacters(std::string_view text, std::size_t offset, std::size_t count)
+{
+    for (offset++; offset < text.size(); offset++)
+    {
+        if ((static_cast<unsigned char>(text[offset]) & 0xC0) != 0x80 && --count == 0)
+            break;
+    }
+    return std::min(offset, text.size());
+}
+
+static bool IsSpeech(ScriptWritingState element)
+{
+    return element == ScriptWritingState::eDialogue || element == ScriptWritingState::eParenthetical;
+}
+
+std::size_t ScriptPageMetrics::GetWidth(ScriptWritingState element) const
+{
+    switch (element)
+    {
+    case ScriptWritingState::eCharacter: return characterWidth;
+    case ScriptWritingState::eParenthetical: return parentheticalWidth;
+    case ScriptWritingState::eDialogue: return dialogueWidth;
+    default: return actionWidth;
+    }
+}
+
+std::size_t ScriptPageMetrics::GetIndent(ScriptWritingState element) const
+{
+    switch (element)
+    {
+    case ScriptWritingState::eCharacter: return characterIndent;
+    case ScriptWritingState::eParenthetical: return parentheticalIndent;
+    case ScriptWritingState::eDialogue: return dialogueIndent;
+    default: return actionIndent;
+    }
+}
+
+ScriptPaginator::ScriptPaginator(const RichTextDocument* doc, const ScriptPageMetrics& metrics)
+    : mDoc(doc)
+    , mMetrics(metrics)
+    , mClassifier(doc)
+{
+}
+
+void ScriptPaginator::SetDocument(const RichTextDocument* doc)
+{
+    mDoc = doc;
+    mClassifier.SetDocument(doc);
+    mLineCounts.clear();
+    mPages.clear();
+    mVersion = 0;
+}
+
+void ScriptPaginator::SetMetrics(const ScriptPageMetrics& metrics)
+{
+    // Every paragraph wraps differently now.
+    mMetrics = metrics;
+    mLineCounts.clear();
+    mPages.clear();
+}
+
+std::size_t ScriptPaginator::GetPageAt(std::size_t paragraph) const
+{
+    auto page = std::upper_bound(mPages.begin(), mPages.end(), paragraph, [](std::size_t paragraph, const PageStart& start) {
+        return paragraph < start.paragraph || (paragraph == start.paragraph && start.line > 0);
+    });
+    return page == mPages.begin() ? 0 : static_cast<std::size_t>(page - mPages.begin() - 1);
+}
+
+void ScriptPaginator::Update()
+{
+    mLastPaginatedCount = 0;
+    if (!mDoc) return;
+
+    mClassifier.Update();
+
+    // Follow the edits as one span of touched paragraphs, in current numbering, and how far
+    // the paragraphs after the span moved.
+    auto count = mDoc->GetLineCount();
+    auto dirtyFrom = count;
+    auto dirtyEnd = std::size_t(0);
+    auto shift = std::ptrdiff_t(0);
+
+    auto inSync = mDoc->GetChangesSince(mVersion, mChanges);
+    if (inSync)
+    {
+        for (const auto& change : mChanges)
+        {
+            auto first = std::min(change.line, mLineCounts.size());
+            auto last = std::min(change.line + change.removedLines + 1, mLineCounts.size());
+            auto inserted = change.insertedLines + 1;
+            auto reused = std::min(last - first, inserted);
+            if (last - first > inserted)
+                mLineCounts.erase(mLineCounts.begin() + first + reused, mLineCounts.begin() + last);
+            else
+                mLineCounts.insert(mLineCounts.begin() + first + reused, inserted - reused, 0);
+
+            auto moved = static_cast<std::ptrdiff_t>(inserted) - static_cast<std::ptrdiff_t>(change.removedLines + 1);
+            if (dirtyEnd > change.line + change.removedLines + 1)
+                dirtyEnd += moved;
+            dirtyEnd = std::max(dirtyEnd, change.line + inserted);
+            dirtyFrom = std::min(dirtyFrom, change.line);
+            shift += moved;
+        }
+    }
+
+    if (!inSync || mPages.empty() || mLineCounts.size() != count)
+    {
+        mLineCounts.assign(count, 0);
+        mPages.clear();
+        dirtyFrom = 0;
+        dirtyEnd = count;
+    }
+
+    mVersion = mDoc->GetVersion();
+
+    // Paragraphs that were classified again may have changed element and with it their width.
+    if (mClassifier.GetLastClassifiedCount() > 0)
+        dirtyEnd = std::max(dirtyEnd, mClassifier.GetLastClassifiedEnd());
+    dirtyEnd = std::min(dirtyEnd, count);
+
+    for (auto paragraph = dirtyFrom; paragraph < dirtyEnd; paragraph++)
+        mLineCounts[paragraph] = static_cast<uint32_t>(MeasureParagraph(paragraph));
+
+    if (dirtyFrom >= dirtyEnd && !mPages.empty())
+        return;
+
+    // A page break looks a few paragraphs ahead to keep headings and cues with what follows,
+    // so resume at the last page that starts far enough before the edit.
+    mPreviousPages.swap(mPages);
+    mPages.clear();
+
+    auto resume = std::size_t(0);
+    if (!mPreviousPages.empty() && dirtyFrom > kLookahead)
+    {
+        auto page = std::lower_bound(mPreviousPages.begin(), mPreviousPages.end(), dirtyFrom - kLookahead, [](const PageStart& start, std::size_t paragraph) {
+            return start.paragraph < paragraph;
+        });
+        resume = static_cast<std::size_t>(std::max<std::ptrdiff_t>(0, (page - mPreviousPages.begin()) - 1));
+    }
+
+    if (mPreviousPages.empty())
+        mPages.push_back(PageStart{0, 0, false});
+    else
+        mPages.assign(mPreviousPages.begin(), mPreviousPages.begin() + resume + 1);
+
+    for (;;)
+    {
+        auto next = PaginatePage(mPages.back());
+        mLastPaginatedCount++;
+        if (next.paragraph >= count)
+            break;
+
+        // Past the edit a page that starts where an old one did lays out the same, and so
+        // does every page after it.
+        if (next.paragraph >= dirtyEnd)
+        {
+            auto previous = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(next.paragraph) - shift);
+            auto match = std::lower_bound(mPreviousPages.begin() + resume, mPreviousPages.end(), next, [shift](const PageStart& start, const PageStart& next) {
+                auto paragraph = static_cast<std::ptrdiff_t>(start.paragraph) + shift;
+                auto nextParagraph = static_cast<std::ptrdiff_t>(next.paragraph);
+                return paragraph < nextParagraph || (paragraph == nextParagraph && start.line < next.line);
+            });
+
+            if (match != mPreviousPages.end() && match->paragraph == previous && match->line == next.line && match->continued == next.continued)
+            {
+                for (; match != mPreviousPages.end(); ++match)
+                    mPages.push_back(PageStart{static_cast<std::size_t>(static_cast<std::ptrdiff_t>(match->paragraph) + shift), match->line, match->continued});
+                break;
+            }
+        }
+
+        mPages.push_back(next);
+    }
+}
+
+ScriptPaginator::PageStart ScriptPaginator::PaginatePage(const PageStart& start)
+{
+    auto count = mLineCounts.size();
+    auto remaining = mMetrics.linesPerPage - (start.continued ? 1 : 0); // The cue repeated with (CONT'D).
+    auto placed = false;
+    auto line = start.line;
+    auto paragraph = start.paragraph;
+
+    for (; paragraph < count; paragraph++, line = 0)
+    {
+        auto element = mClassifier.GetElement(paragraph);
+        auto lines = mLineCounts[paragraph] - line;
+
+        // Blank lines are only spacing, one that does not fit is dropped with the page break.
+        if (element == ScriptWritingState::eNone)
+        {
+            if (lines > remaining)
+                return PageStart{SkipBlankParagraphs(paragraph), 0, false};
+            remaining -= lines;
+            continue;
+        }
+
+        // Ending the page in the middle of a speech takes a line for (MORE).
+        auto speechGoesOn = IsSpeech(element) && paragraph + 1 < count && IsSpeech(mClassifier.GetElement(paragraph + 1));
+        auto needed = lines + GetKeptWithNext(paragraph) + (speechGoesOn ? 1 : 0);
+        if (needed <= remaining || (!placed && lines <= remaining))
+        {
+            remaining -= lines;
+            placed = true;
+            continue;
+        }
+
+        auto more = element == ScriptWritingState::eDialogue ? std::size_t(1) : std::size_t(0);
+        auto room = remaining > more ? remaining - more : 0;
+
+        // Action and dialogue split with at least two lines left behind and two carried over.
+        if ((element == ScriptWritingState::eAction || element == ScriptWritingState::eDialogue) && lines >= 4)
+        {
+            auto kept = std::min(room, lines - 2);
+            if (kept >= 2)
+                return PageStart{paragraph, line + kept, more > 0};
+        }
+
+        // A paragraph longer than a whole page is split wherever the page ends.
+        if (!placed)
+            return PageStart{paragraph, line + std::max<std::size_t>(room, 1), more > 0};
+
+        // Speech moves over together with its cue and parentheticals. If part of the speech
+        // is on this page already, the page ends in (MORE) and the next one continues it.
+        auto breakAt = paragraph;
+        if (IsSpeech(element) && line == 0)
+        {
+            auto firstWhole = start.line > 0 ? start.paragraph + 1 : start.paragraph;
+            while (breakAt > firstWhole && mClassifier.GetElement(breakAt - 1) == ScriptWritingState::eParenthetical)
+                breakAt--;
+            if (breakAt > firstWhole && mClassifier.GetElement(breakAt - 1) == ScriptWritingState::eCharacter)
+                breakAt--;
+
+            if (breakAt == firstWhole)
+                breakAt = paragraph;
+        }
+
+        auto continued = breakAt > 0 && IsSpeech(mClassifier.GetElement(breakAt)) && IsSpeech(mClassifier.GetElement(breakAt - 1));
+        return PageStart{breakAt, line, continued};
+    }
+
+    return PageStart{count, 0, false};
+}
+
+std::size_t ScriptPaginator::MeasureParagraph(std::size_t paragraph)
+{
+    auto element = mClassifier.GetElement(paragraph);
+    if (element == ScriptWritingState::eNone)
+        return 1;
+
+    return WrapParagraph(GetParagraphText(paragraph, mText), mMetrics.GetWidth(element));
+}
+
+std::string_view ScriptPaginator::GetParagraphText(std::size_t paragraph, std::string& scratch) const
+{
+    return TrimWhitespace(::GetParagraphText(*mDoc, paragraph, scratch));
+}
+
+std::size_t ScriptPaginator::WrapParagraph(std::string_view text, std::size_t width, std::vector<std::string_view>* lines)
+{
+    auto lineStart = text.find_first_not_of(' ');
+    if (lineStart == std::string_view::npos)
+    {
+        if (lines) lines->push_back({});
+        return 1;
+    }
+
+    auto emit = [&](std::size_t start, std::size_t end) {
+        if (lines) lines->push_back(text.substr(start, end - start));
+    };
+
+    std::size_t count = 1;
+    std::size_t column = 0;
+    auto lineEnd = lineStart;
+    auto word = lineStart;
+    while (word != std::string_view::npos)
+    {
+        auto wordEnd = std::min(text.find(' ', word), text.size());
+        auto length = CountCharacters(text.substr(word, wordEnd - word));
+
+        if (column > 0 && column + 1 + length <= width)
+        {
+            column += 1 + length;
+        }
+        else
+        {
+            if (column > 0)
+            {
+                emit(lineStart, lineEnd);
+                count++;
+            }
+
+            // Words longer than a line are broken every width characters.
+            lineStart = word;
+            for (; length > width; length -= width, count++)
+            {
+                auto cut = AdvanceCharacters(text, lineStart, width);
+                emit(lineStart, cut);
+                lineStart = cut;
+            }
+            column = length;
+        }
+
+        lineEnd = wordEnd;
+        word = text.find_first_not_of(' ', wordEnd);
+    }
+
+    emit(lineStart, lineEnd);
+    return count;
+}
+
+std::size_t ScriptPaginator::GetKeptWithNext(std::size_t paragraph) const
+{
+    auto element = mClassifier.GetElement(paragraph);
+    if (element != ScriptWritingState::eHeading && element != ScriptWritingState::eCharacter && element != ScriptWritingState::eParenthetical)
+        return 0;
+
+    // Headings take the blank line under them along, cues their parentheticals, and all of
+    // them the first two lines of what they introduce.
+    std::size_t kept = 0;
+    for (auto next = paragraph + 1; next < mLineCounts.size() && next <= paragraph + kLookahead; next++)
+    {
+        auto nextElement = mClassifier.GetElement(next);
+        if (nextElement == ScriptWritingState::eNone)
+        {
+            if (element != ScriptWritingState::eHeading)
+                break;
+            kept += mLineCounts[next];
+            continue;
+        }
+
+        if (nextElement == ScriptWritingState::eCharacter || nextElement == ScriptWritingState::eParenthetical)
+        {
+            kept += mLineCounts[next];
+            continue;
+        }
+
+        kept += std::min<std::size_t>(2, mLineCounts[next]);
+        break;
+    }
+
+    return kept;
+}
+
+std::size_t ScriptPaginator::SkipBlankParagraphs(std::size_t paragraph) const
+{
+    while (paragraph < mLineCounts.size() && mClassifier.GetElement(paragraph) == ScriptWritingState::eNone)
+        paragraph++;
+    return paragraph;
+}
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include "RichTextDocument.h"
 
 enum class ScriptWritingState {
     eNone,
@@ -19,4 +25,134 @@ public:
 private:
     std::string name;
     std::string script;
-};
\ No newline at end of file
+};
+
+// Tags every paragraph of a document with the screenplay element it holds. A paragraph's
+// element depends on its own text and on the element before it, e.g. a line under a
+// character cue is dialogue. Updates follow the document's change journal: only paragraphs
+// an edit touched are classified again, then their successors for as long as their
+// element keeps changing.
+class ScriptClassifier {
+public:
+    explicit ScriptClassifier(const RichTextDocument* doc = nullptr);
+    ~ScriptClassifier() = default;
+
+    void SetDocument(const RichTextDocument* doc);
+
+    // Brings the elements up to date with the document.
+    void Update();
+
+    std::size_t GetParagraphCount() const { return mParagraphs.size(); }
+    ScriptWritingState GetElement(std::size_t paragraph) const;
+
+    // How many paragraphs the last Update classified, for measuring, and the end of the last
+    // one. Elements at and after the end are as they were before.
+    std::size_t GetLastClassifiedCount() const { return mLastClassifiedCount; }
+    std::size_t GetLastClassifiedEnd() const { return mLastClassifiedEnd; }
+
+    // Blank lines are eNone, INT./EXT. lines are headings, an all-caps line is a character
+    // cue, followed by parentheticals and dialogue. Everything else is action.
+    static ScriptWritingState Classify(std::string_view text, ScriptWritingState previous);
+
+private:
+    struct Paragraph {
+        ScriptWritingState element = ScriptWritingState::eNone;
+        bool valid = false;
+    };
+
+    ScriptWritingState ClassifyParagraph(std::size_t paragraph, ScriptWritingState previous);
+
+    const RichTextDocument* mDoc;
+    std::vector<Paragraph> mParagraphs;
+    std::vector<RichTextChange> mChanges;
+    std::string mText; // Scratch buffer for the paragraph being classified.
+    uint64_t mVersion = 0;
+    std::size_t mInvalidCount = 0;
+    std::size_t mLastClassifiedCount = 0;
+    std::size_t mLastClassifiedEnd = 0;
+};
+
+// Page geometry of a screenplay in lines and characters of 12 pt Courier on US Letter, six
+// lines and ten characters to the inch. Widths follow the usual element margins.
+struct ScriptPageMetrics {
+    std::size_t linesPerPage = 54;       // 1" top and bottom margins, the page number sits above.
+    std::size_t actionWidth = 60;        // 1.5" to 7.5", headings use it as well.
+    std::size_t characterWidth = 38;     // 3.7" to 7.5".
+    std::size_t parentheticalWidth = 25; // 3.1" to 5.6".
+    std::size_t dialogueWidth = 35;      // 2.5" to 6".
+
+    // Where each element starts, in characters from the left edge of the page.
+    std::size_t actionIndent = 15;
+    std::size_t characterIndent = 37;
+    std::size_t parentheticalIndent = 31;
+    std::size_t dialogueIndent = 25;
+
+    std::size_t GetWidth(ScriptWritingState element) const;
+    std::size_t GetIndent(ScriptWritingState element) const;
+};
+
+// Breaks a screenplay into pages the way the industry counts them. Headings, cues and
+// parentheticals are kept with what follows them, action and dialogue split only with at
+// least two lines on either side, and dialogue carried to the next page ends in (MORE) and
+// picks up under the cue with (CONT'D).
+//
+// Only page starts are stored. After an edit pagination resumes at the first page the edit
+// can affect and stops as soon as a new page starts where an old one did, the old pages
+// after it are taken over as they are.
+class ScriptPaginator {
+public:
+    // Where a page begins: a paragraph, the first of its wrapped lines on the page and
+    // whether the page continues dialogue from the one before.
+    struct PageStart {
+        std::size_t paragraph;
+        std::size_t line;
+        bool continued;
+    };
+
+    explicit ScriptPaginator(const RichTextDocument* doc = nullptr, const ScriptPageMetrics& metrics = ScriptPageMetrics());
+    ~ScriptPaginator() = default;
+
+    void SetDocument(const RichTextDocument* doc);
+    void SetMetrics(const ScriptPageMetrics& metrics);
+
+    // Brings the elements and the pages up to date with the document.
+    void Update();
+
+    std::size_t GetPageCount() const { return mPages.size(); }
+    std::size_t GetPageAt(std::size_t paragraph) const; // Zero based, the page the paragraph begins on.
+    const PageStart& GetPageStart(std::size_t page) const { return mPages[page]; }
+    std::size_t GetLineCount(std::size_t paragraph) const { return mLineCounts[paragraph]; } // Wrapped at its element's width.
+    const ScriptClassifier& GetClassifier() const { return mClassifier; }
+    const ScriptPageMetrics& GetMetrics() const { return mMetrics; }
+
+    // How many pages the last Update laid out, for measuring.
+    std::size_t GetLastPaginatedCount() const { return mLastPaginatedCount; }
+
+    // The paragraph's text without surrounding whitespace, joined into scratch when it is
+    // made of several runs. Safe to call from several threads with their own scratch.
+    std::string_view GetParagraphText(std::size_t paragraph, std::string& scratch) const;
+
+    // Word wraps text at a width in characters the way pages are counted. Returns the number
+    // of lines and appends them to lines when given.
+    static std::size_t WrapParagraph(std::string_view text, std::size_t width, std::vector<std::string_view>* lines = nullptr);
+
+private:
+    // Keep-with-next looks at most this many paragraphs ahead.
+    static constexpr std::size_t kLookahead = 8;
+
+    PageStart PaginatePage(const PageStart& start);
+    std::size_t MeasureParagraph(std::size_t paragraph);
+    std::size_t GetKeptWithNext(std::size_t paragraph) const;
+    std::size_t SkipBlankParagraphs(std::size_t paragraph) const;
+
+    const RichTextDocument* mDoc;
+    ScriptPageMetrics mMetrics;
+    ScriptClassifier mClassifier;
+    std::vector<uint32_t> mLineCounts;
+    std::vector<PageStart> mPages;
+    std::vector<PageStart> mPreviousPages;
+    std::vector<RichTextChange> mChanges;
+    std::string mText; // Scratch buffer for the paragraph being measured.
+    uint64_t mVersion = 0;
+    std::size_t mLastPaginatedCount = 0;
+};
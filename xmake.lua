@@ -1,11 +1,37 @@
-add_requires("libsdl3", "nlohmann_json", "freetype", "plutosvg")
+add_requires("libsdl3", "nlohmann_json", "freetype", "plutosvg", "poco")
+
+local core_files = {
+    "source/PieceTable.cpp",
+    "source/RichTextDocument.cpp",
+    "source/RichTextHistory.cpp",
+    "source/RichTextStyle.cpp",
+    "source/ScriptPdfExporter.cpp",
+    "source/ScriptProject.cpp",
+    "source/StoryGraphAnalysis.cpp",
+    "source/StoryRuntime.cpp",
+    "source/script.cpp",
+}
+
+target("scriptr_core")
+    set_kind("static")
+    set_languages("cxx17")
+    add_files(core_files)
+    add_includedirs("source", {public = true})
+    add_packages("nlohmann_json", "poco", {public = true})
+
+target("scriptr-cli")
+    set_kind("binary")
+    set_languages("cxx17")
+    add_files("source/cli/main.cpp")
+    add_deps("scriptr_core")
 
 target("scriptr")
     set_kind("binary")
     set_languages("cxx17")
-    add_files("source/*.cpp")
+    add_files("source/*.cpp|" .. table.concat(core_files, "|"):gsub("source/", ""))
     add_files("source/imgui/*.cpp")
     add_files("source/glad/src/gl.c")
     add_includedirs("source/glad/include")
     add_includedirs("source/imgui")
-    add_packages("libsdl3", "nlohmann_json", "freetype", "plutosvg")
\ No newline at end of file
+    add_deps("scriptr_core")
+    add_packages("libsdl3", "nlohmann_json", "freetype", "plutosvg", "poco")